@@ -0,0 +1,31 @@
+# - Generate the amalgamated source uecc_all.c
+#
+# Run by the amalgamation target. Concatenates the internal header and all
+# library sources into a single file, which can either be compiled on its own
+# or, with UECC_STATIC_INLINE defined before including libuecc/ecc.h, be
+# included into another translation unit.
+#
+# Variables:
+#  SOURCE_DIR - Directory of the library sources
+#  SOURCES    - List of the library sources
+#  HEADERS    - List of the internal headers, in the order of their dependencies
+#  OUTPUT     - Path of the generated file
+
+file(WRITE ${OUTPUT} "/* Generated from the libuecc sources by Amalgamate.cmake, do not edit */\n\n")
+
+# Sources needing GNU extensions (like SCHED_IDLE in ec25519_pool.c) define
+# _GNU_SOURCE before their first include, which would be too late in the middle
+# of the amalgamation, so it is defined in front of everything
+file(APPEND ${OUTPUT} "#ifndef _GNU_SOURCE\n#define _GNU_SOURCE\n#endif\n\n")
+
+foreach(source ${HEADERS} ${SOURCES})
+  file(READ ${SOURCE_DIR}/${source} content)
+
+  # The internal headers are inlined in front of the sources; the include
+  # is replaced with an empty line to keep the line numbers
+  foreach(header ${HEADERS})
+    string(REPLACE "#include \"${header}\"\n" "\n" content "${content}")
+  endforeach(header)
+
+  file(APPEND ${OUTPUT} "#line 1 \"${source}\"\n${content}\n")
+endforeach(source)
@@ -0,0 +1,57 @@
+# - Report stack usage and code size
+#
+# Run by the stack_usage target when libuecc is configured with
+# ENABLE_STACK_USAGE. Prints the stack frame sizes recorded by -fstack-usage
+# for all functions of the library, largest first, followed by the output
+# of size(1) for the object files.
+#
+# The frame sizes don't include the frames of called functions; the peak
+# stack usage of an operation is the sum of the frames along its deepest
+# call chain (e.g. ecc_25519_scalarmult -> ecc_25519_add -> mult).
+#
+# Variables:
+#  STACK_USAGE_DIR - Directory containing the .su and object files
+#  SIZE_EXECUTABLE - Path of size(1) (optional)
+
+file(GLOB_RECURSE su_files "${STACK_USAGE_DIR}/*.su")
+
+if(NOT su_files)
+  message(FATAL_ERROR "No stack usage files found in ${STACK_USAGE_DIR}")
+endif(NOT su_files)
+
+set(entries)
+foreach(su_file ${su_files})
+  file(STRINGS ${su_file} lines)
+  foreach(line ${lines})
+    # Format: file:line:column:function<TAB>bytes<TAB>qualifiers
+    if(line MATCHES "^.*:([^:\t]+)\t([0-9]+)\t([a-z,]+)$")
+      set(name ${CMAKE_MATCH_1})
+      set(bytes ${CMAKE_MATCH_2})
+      set(qualifiers ${CMAKE_MATCH_3})
+
+      # Pad the size so the lexical sort orders the entries numerically
+      string(LENGTH ${bytes} len)
+      set(padded ${bytes})
+      while(len LESS 8)
+        set(padded " ${padded}")
+        math(EXPR len "${len} + 1")
+      endwhile(len LESS 8)
+
+      list(APPEND entries "${padded}  ${name} (${qualifiers})")
+    endif()
+  endforeach(line)
+endforeach(su_file)
+
+list(SORT entries)
+list(REVERSE entries)
+
+message("Stack frame sizes (bytes):")
+foreach(entry ${entries})
+  message("${entry}")
+endforeach(entry)
+
+if(SIZE_EXECUTABLE)
+  file(GLOB_RECURSE objects "${STACK_USAGE_DIR}/*.o")
+  execute_process(COMMAND ${SIZE_EXECUTABLE} ${objects} OUTPUT_VARIABLE size_output)
+  message("\nCode size:\n${size_output}")
+endif(SIZE_EXECUTABLE)
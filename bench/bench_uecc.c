@@ -0,0 +1,600 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Benchmark of the public API and the internal prime field operations of libuecc
+ *
+ * Each operation is run for a number of samples; the number of iterations per sample
+ * is chosen so that a sample takes about 2ms. The median and the 10th and 90th percentiles
+ * of the time per operation over all samples are reported. Cycle counts are read from the
+ * time stamp counter and are only available on x86.
+ *
+ * Usage: bench_uecc [-j] [-s samples] [-t threads] [-b batch size] [filter]
+ *
+ *   -j  Print results as JSON
+ *   -s  Number of samples per operation (default: 21)
+ *   -t  Measure the throughput of ecc_25519_scalarmult_batch_workers with 1 up to the given number of threads
+ *   -b  Number of multiplications per batch for -t (default: 64)
+ *
+ * Only operations whose names contain the filter string are measured.
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC
+#endif
+
+/* Included to get access to the internal functions */
+#include "ec25519.c"
+
+
+/** The target duration of a single sample */
+#define SAMPLE_NS 2000000
+
+
+typedef struct op {
+	const char *name;
+	void (*run)(void);
+} op_t;
+
+typedef struct result {
+	const char *name;
+	unsigned iterations;
+	unsigned samples;
+	double median;
+	double p10;
+	double p90;
+	double cycles;
+} result_t;
+
+
+/** Inputs and outputs of the benchmarked operations */
+static struct {
+	ecc_int256_t n;
+	ecc_int256_t x, y;
+	ecc_int256_t packed_ed25519;
+	ecc_int256_t packed_legacy;
+	ecc_int256_t packed_ristretto255;
+	ecc_int256_t packed_montgomery;
+	uint8_t uniform[64];
+	ecc_int256_t out;
+
+	ecc_25519_work_t P;
+	ecc_25519_work_t Q;
+	ecc_25519_work_t R;
+	ecc_25519_work_compact_t compact;
+	ecc_25519_enum_t enumeration;
+	ecc_25519_fixed_base_t fixed_base;
+	ecc_25519_fixed_base_t fixed_other;
+	ecc_25519_ctx_t ctx;
+	ecc_25519_ctx_t ctx_other;
+	ecc_25519_scalarmult_state_t scalarmult_state;
+	ecc_25519_scalarmult_state_t finish_state;
+	uint8_t ctx_arena[sizeof(ecc_25519_fixed_base_t) + 64*TRANSCODE_SCRATCH];
+	uint8_t ctx_other_arena[sizeof(ecc_25519_fixed_base_t) + 64*TRANSCODE_SCRATCH];
+
+	ecc_25519_queue_t *queue;
+	ecc_25519_job_t job, job_done;
+	ecc_25519_pool_t *pool;
+	ecc_25519_keypair_t keypair;
+	ecc_25519_stats_t stats;
+
+	ecc_25519_work_t points[64];
+	ecc_25519_work_t many[64];
+	ecc_int256_t packed[64];
+	ecc_int256_t packed_legacy_array[64];
+	ecc_int256_t packed_ed25519_array[64];
+	ecc_int256_t gf_batch_out[64];
+
+	ecc_25519_gf_mont_t mont_x, mont_y, mont_out;
+	ecc_int256_t exp;
+
+	uint32_t a[32];
+	uint32_t b[32];
+	uint32_t c[32];
+	int ret;
+} s;
+
+
+static void bench_scalarmult(void) { ecc_25519_scalarmult(&s.R, &s.n, &s.P); }
+static void bench_scalarmult_bits(void) { ecc_25519_scalarmult_bits(&s.R, &s.n, &s.P, 128); }
+static void bench_scalarmult_x2(void) { ecc_25519_scalarmult_x2(&s.R, &s.n, &s.P, &s.many[0], &s.x, &s.Q); }
+static void bench_scalarmult_begin(void) { ecc_25519_scalarmult_begin(&s.scalarmult_state, &s.n, &s.P); }
+/* The position is reset so every call does a full slice of the ladder */
+static void bench_scalarmult_step(void) { s.scalarmult_state.pos = 256; ecc_25519_scalarmult_step(&s.scalarmult_state, 16); }
+/* All steps of the ladder are already done, so only the recovery of the result is measured */
+static void bench_scalarmult_finish(void) { ecc_25519_scalarmult_finish(&s.finish_state, &s.R); }
+static void bench_scalarmult_vartime(void) { ecc_25519_scalarmult_vartime(&s.R, &s.n, &s.P); }
+static void bench_scalarmult_many(void) { ecc_25519_scalarmult_many(s.many, &s.n, s.points, 64); }
+static void bench_scalarmult_joint(void) { ecc_25519_scalarmult_joint(&s.R, &s.n, &s.P, &s.x, &s.Q); }
+static void bench_scalarmult_base(void) { ecc_25519_scalarmult_base(&s.R, &s.n); }
+static void bench_scalarmult_base_bits(void) { ecc_25519_scalarmult_base_bits(&s.R, &s.n, 128); }
+static void bench_scalarmult_base_ctx(void) { ecc_25519_scalarmult_base_ctx(&s.ctx, &s.R, &s.n); }
+static void bench_ecdh_packed(void) { s.ret = ecc_25519_ecdh_packed(&s.out, &s.n, &s.packed_ed25519, ECC_25519_FORMAT_ED25519); }
+static void bench_fhmqv_packed(void) { s.ret = ecc_25519_fhmqv_packed(&s.out, &s.n, &s.x, &s.y, &s.x, &s.packed_ed25519, &s.packed_ed25519, ECC_25519_FORMAT_ED25519); }
+static void bench_load_xy_ed25519(void) { s.ret = ecc_25519_load_xy_ed25519(&s.R, &s.x, &s.y); }
+static void bench_store_xy_ed25519(void) { ecc_25519_store_xy_ed25519(&s.x, &s.y, &s.P); }
+static void bench_load_packed_ed25519(void) { s.ret = ecc_25519_load_packed_ed25519(&s.R, &s.packed_ed25519); }
+static void bench_load_packed_legacy(void) { s.ret = ecc_25519_load_packed_legacy(&s.R, &s.packed_legacy); }
+static void bench_store_packed_ed25519(void) { ecc_25519_store_packed_ed25519(&s.out, &s.P); }
+static void bench_store_packed_legacy(void) { ecc_25519_store_packed_legacy(&s.out, &s.P); }
+static void bench_load_packed_ristretto255(void) { s.ret = ecc_25519_load_packed_ristretto255(&s.R, &s.packed_ristretto255); }
+static void bench_store_packed_ristretto255(void) { ecc_25519_store_packed_ristretto255(&s.out, &s.P); }
+static void bench_ristretto255_equal(void) { s.ret = ecc_25519_ristretto255_equal(&s.P, &s.Q); }
+static void bench_ristretto255_from_uniform(void) { ecc_25519_ristretto255_from_uniform(&s.R, s.uniform); }
+static void bench_store_packed_ed25519_batch(void) { ecc_25519_store_packed_ed25519_batch(s.packed, s.points, 64); }
+static void bench_store_packed_legacy_batch(void) { ecc_25519_store_packed_legacy_batch(s.packed, s.points, 64); }
+static void bench_store_packed_montgomery_batch(void) { ecc_25519_store_packed_montgomery_batch(s.packed, s.points, 64); }
+static void bench_load_packed_montgomery(void) { s.ret = ecc_25519_load_packed_montgomery(&s.R, &s.packed_montgomery); }
+static void bench_store_packed_montgomery(void) { ecc_25519_store_packed_montgomery(&s.out, &s.P); }
+static void bench_transcode_legacy_ed25519(void) { ecc_25519_transcode_packed_batch(s.packed, NULL, s.packed_legacy_array, 64, ECC_25519_FORMAT_LEGACY, ECC_25519_FORMAT_ED25519); }
+static void bench_transcode_ed25519_montgomery(void) { ecc_25519_transcode_packed_batch(s.packed, NULL, s.packed_ed25519_array, 64, ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_MONTGOMERY); }
+static void bench_transcode_ed25519_montgomery_ctx(void) { ecc_25519_transcode_packed_batch_ctx(&s.ctx, s.packed, NULL, s.packed_ed25519_array, 64, ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_MONTGOMERY); }
+static void bench_fixed_base_init(void) { ecc_25519_fixed_base_init(&s.fixed_other, &s.P); }
+static void bench_scalarmult_fixed(void) { ecc_25519_scalarmult_fixed(&s.R, &s.n, &s.fixed_base); }
+static void bench_scalarmult_fixed_joint(void) { ecc_25519_scalarmult_fixed_joint(&s.R, &s.n, &s.fixed_base, &s.x, &s.fixed_other); }
+static void bench_enum_next(void) { ecc_25519_enum_next(&s.enumeration, s.packed, 64, ECC_25519_FORMAT_ED25519); }
+static void bench_store_compact(void) { ecc_25519_store_compact(&s.compact, &s.P); }
+static void bench_load_compact(void) { ecc_25519_load_compact(&s.R, &s.compact); }
+static void bench_is_identity(void) { s.ret = ecc_25519_is_identity(&s.P); }
+static void bench_is_small_order(void) { s.ret = ecc_25519_is_small_order(&s.P); }
+static void bench_in_prime_subgroup(void) { s.ret = ecc_25519_in_prime_subgroup(&s.P); }
+static void bench_equal(void) { s.ret = ecc_25519_equal(&s.P, &s.Q); }
+static void bench_negate(void) { ecc_25519_negate(&s.R, &s.P); }
+static void bench_double(void) { ecc_25519_double(&s.R, &s.P); }
+static void bench_add(void) { ecc_25519_add(&s.R, &s.P, &s.Q); }
+static void bench_sub(void) { ecc_25519_sub(&s.R, &s.P, &s.Q); }
+
+static void bench_gf_is_zero(void) { s.ret = ecc_25519_gf_is_zero(&s.x); }
+static void bench_gf_add(void) { ecc_25519_gf_add(&s.out, &s.x, &s.y); }
+static void bench_gf_sub(void) { ecc_25519_gf_sub(&s.out, &s.x, &s.y); }
+static void bench_gf_reduce(void) { ecc_25519_gf_reduce(&s.out, &s.x); }
+static void bench_gf_mult(void) { ecc_25519_gf_mult(&s.out, &s.x, &s.y); }
+static void bench_gf_mont_to(void) { ecc_25519_gf_mont_to(&s.mont_out, &s.x); }
+static void bench_gf_mont_from(void) { ecc_25519_gf_mont_from(&s.out, &s.mont_x); }
+static void bench_gf_mont_add(void) { ecc_25519_gf_mont_add(&s.mont_out, &s.mont_x, &s.mont_y); }
+static void bench_gf_mont_sub(void) { ecc_25519_gf_mont_sub(&s.mont_out, &s.mont_x, &s.mont_y); }
+static void bench_gf_mont_mult(void) { ecc_25519_gf_mont_mult(&s.mont_out, &s.mont_x, &s.mont_y); }
+static void bench_gf_mont_square(void) { ecc_25519_gf_mont_square(&s.mont_out, &s.mont_x); }
+static void bench_gf_mont_pow(void) { ecc_25519_gf_mont_pow(&s.mont_out, &s.mont_x, &s.exp); }
+static void bench_gf_add_batch(void) { ecc_25519_gf_add_batch(s.gf_batch_out, s.packed_ed25519_array, s.packed_legacy_array, 64); }
+static void bench_gf_reduce_batch(void) { ecc_25519_gf_reduce_batch(s.gf_batch_out, s.packed_ed25519_array, 64); }
+static void bench_gf_mult_batch(void) { ecc_25519_gf_mult_batch(s.gf_batch_out, s.packed_ed25519_array, s.packed_legacy_array, 64); }
+static void bench_gf_recip(void) { ecc_25519_gf_recip(&s.out, &s.x); }
+static void bench_gf_sanitize_secret(void) { ecc_25519_gf_sanitize_secret(&s.out, &s.x); }
+
+/* Submits a job and waits until it can be collected; the secret of the collected job is wiped, so it is kept separately */
+static void bench_queue_round_trip(void) {
+	struct pollfd pfd = {.fd = ecc_25519_queue_fd(s.queue), .events = POLLIN};
+
+	ecc_25519_queue_submit(s.queue, &s.job);
+
+	while (!ecc_25519_queue_poll(s.queue, &s.job_done, 1))
+		poll(&pfd, 1, -1);
+}
+
+/* The loop drains the pool much faster than it is refilled, so mostly the case of an empty pool is measured */
+static void bench_pool_get(void) { s.ret = ecc_25519_pool_get(s.pool, &s.keypair); }
+static void bench_ctx_init(void) { s.ret = ecc_25519_ctx_init(&s.ctx_other, s.ctx_other_arena, sizeof(s.ctx_other_arena), ECC_25519_CTX_BASE_TABLE); }
+static void bench_stats_get(void) { ecc_25519_stats_get(&s.stats); }
+
+static void bench_mult(void) { mult(s.c, s.a, s.b); }
+static void bench_square(void) { square(s.c, s.a); }
+static void bench_recip(void) { recip(s.c, s.a); }
+static void bench_square_root_ratio(void) { s.ret = square_root_ratio(s.c, s.a, s.b); }
+
+
+static const op_t ops[] = {
+	{"ecc_25519_scalarmult", bench_scalarmult},
+	{"ecc_25519_scalarmult_bits(128)", bench_scalarmult_bits},
+	{"ecc_25519_scalarmult_x2", bench_scalarmult_x2},
+	{"ecc_25519_scalarmult_begin", bench_scalarmult_begin},
+	{"ecc_25519_scalarmult_step(16)", bench_scalarmult_step},
+	{"ecc_25519_scalarmult_finish", bench_scalarmult_finish},
+	{"ecc_25519_scalarmult_many(64)", bench_scalarmult_many},
+	{"ecc_25519_scalarmult_joint", bench_scalarmult_joint},
+	{"ecc_25519_scalarmult_base", bench_scalarmult_base},
+	{"ecc_25519_scalarmult_base_bits(128)", bench_scalarmult_base_bits},
+	{"ecc_25519_scalarmult_base_ctx", bench_scalarmult_base_ctx},
+	{"ecc_25519_scalarmult_vartime", bench_scalarmult_vartime},
+	{"ecc_25519_fixed_base_init", bench_fixed_base_init},
+	{"ecc_25519_scalarmult_fixed", bench_scalarmult_fixed},
+	{"ecc_25519_scalarmult_fixed_joint", bench_scalarmult_fixed_joint},
+	{"ecc_25519_ecdh_packed", bench_ecdh_packed},
+	{"ecc_25519_fhmqv_packed", bench_fhmqv_packed},
+	{"ecc_25519_load_xy_ed25519", bench_load_xy_ed25519},
+	{"ecc_25519_store_xy_ed25519", bench_store_xy_ed25519},
+	{"ecc_25519_load_packed_ed25519", bench_load_packed_ed25519},
+	{"ecc_25519_load_packed_legacy", bench_load_packed_legacy},
+	{"ecc_25519_store_packed_ed25519", bench_store_packed_ed25519},
+	{"ecc_25519_store_packed_legacy", bench_store_packed_legacy},
+	{"ecc_25519_load_packed_ristretto255", bench_load_packed_ristretto255},
+	{"ecc_25519_store_packed_ristretto255", bench_store_packed_ristretto255},
+	{"ecc_25519_ristretto255_equal", bench_ristretto255_equal},
+	{"ecc_25519_ristretto255_from_uniform", bench_ristretto255_from_uniform},
+	{"ecc_25519_store_packed_ed25519_batch(64)", bench_store_packed_ed25519_batch},
+	{"ecc_25519_store_packed_legacy_batch(64)", bench_store_packed_legacy_batch},
+	{"ecc_25519_store_packed_montgomery_batch(64)", bench_store_packed_montgomery_batch},
+	{"ecc_25519_load_packed_montgomery", bench_load_packed_montgomery},
+	{"ecc_25519_store_packed_montgomery", bench_store_packed_montgomery},
+	{"ecc_25519_transcode_packed_batch(64, legacy, ed25519)", bench_transcode_legacy_ed25519},
+	{"ecc_25519_transcode_packed_batch(64, ed25519, montgomery)", bench_transcode_ed25519_montgomery},
+	{"ecc_25519_transcode_packed_batch_ctx(64, ed25519, montgomery)", bench_transcode_ed25519_montgomery_ctx},
+	{"ecc_25519_enum_next(64, ed25519)", bench_enum_next},
+	{"ecc_25519_store_compact", bench_store_compact},
+	{"ecc_25519_load_compact", bench_load_compact},
+	{"ecc_25519_is_identity", bench_is_identity},
+	{"ecc_25519_is_small_order", bench_is_small_order},
+	{"ecc_25519_in_prime_subgroup", bench_in_prime_subgroup},
+	{"ecc_25519_equal", bench_equal},
+	{"ecc_25519_negate", bench_negate},
+	{"ecc_25519_double", bench_double},
+	{"ecc_25519_add", bench_add},
+	{"ecc_25519_sub", bench_sub},
+
+	{"ecc_25519_gf_is_zero", bench_gf_is_zero},
+	{"ecc_25519_gf_add", bench_gf_add},
+	{"ecc_25519_gf_sub", bench_gf_sub},
+	{"ecc_25519_gf_reduce", bench_gf_reduce},
+	{"ecc_25519_gf_mult", bench_gf_mult},
+	{"ecc_25519_gf_mont_to", bench_gf_mont_to},
+	{"ecc_25519_gf_mont_from", bench_gf_mont_from},
+	{"ecc_25519_gf_mont_add", bench_gf_mont_add},
+	{"ecc_25519_gf_mont_sub", bench_gf_mont_sub},
+	{"ecc_25519_gf_mont_mult", bench_gf_mont_mult},
+	{"ecc_25519_gf_mont_square", bench_gf_mont_square},
+	{"ecc_25519_gf_mont_pow", bench_gf_mont_pow},
+	{"ecc_25519_gf_add_batch(64)", bench_gf_add_batch},
+	{"ecc_25519_gf_reduce_batch(64)", bench_gf_reduce_batch},
+	{"ecc_25519_gf_mult_batch(64)", bench_gf_mult_batch},
+	{"ecc_25519_gf_recip", bench_gf_recip},
+	{"ecc_25519_gf_sanitize_secret", bench_gf_sanitize_secret},
+
+	{"ecc_25519_queue_submit+poll", bench_queue_round_trip},
+	{"ecc_25519_pool_get", bench_pool_get},
+	{"ecc_25519_ctx_init(BASE_TABLE)", bench_ctx_init},
+	{"ecc_25519_stats_get", bench_stats_get},
+
+	{"internal:mult", bench_mult},
+	{"internal:square", bench_square},
+	{"internal:recip", bench_recip},
+	{"internal:square_root_ratio", bench_square_root_ratio},
+};
+
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static int compare_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/** Returns the given percentile of a sorted array */
+static double percentile(const double *v, unsigned n, double pct) {
+	double pos = pct / 100 * (n - 1);
+	unsigned i = pos;
+
+	if (i + 1 >= n)
+		return v[n - 1];
+
+	return v[i] + (pos - i) * (v[i + 1] - v[i]);
+}
+
+/** Deterministic "random" bytes for the keypair pool; the keys don't need to be secret here */
+static int bench_random(void *arg, uint8_t *buf, size_t len) {
+	uint8_t *counter = arg;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (*counter)++ * 73 + 19;
+
+	return 1;
+}
+
+static void init_inputs(void) {
+	static uint8_t pool_counter;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		s.n.p[i] = 17*i + 3;
+		s.x.p[i] = 29*i + 5;
+		s.y.p[i] = 31*i + 7;
+		s.exp.p[i] = 41*i + 13;
+	}
+
+	for (i = 0; i < 64; i++)
+		s.uniform[i] = 37*i + 11;
+
+	ecc_25519_scalarmult_base(&s.P, &s.n);
+	ecc_25519_double(&s.Q, &s.P);
+	ecc_25519_store_packed_ed25519(&s.packed_ed25519, &s.P);
+	ecc_25519_store_packed_legacy(&s.packed_legacy, &s.P);
+	ecc_25519_store_packed_ristretto255(&s.packed_ristretto255, &s.P);
+	ecc_25519_store_packed_montgomery(&s.packed_montgomery, &s.P);
+	ecc_25519_store_compact(&s.compact, &s.P);
+	ecc_25519_enum_init(&s.enumeration, &s.n, &s.y);
+	ecc_25519_fixed_base_init(&s.fixed_base, &ecc_25519_work_default_base);
+	ecc_25519_fixed_base_init(&s.fixed_other, &s.P);
+	ecc_25519_ctx_init(&s.ctx, s.ctx_arena, sizeof(s.ctx_arena), ECC_25519_CTX_BASE_TABLE);
+	ecc_25519_gf_mont_to(&s.mont_x, &s.x);
+	ecc_25519_gf_mont_to(&s.mont_y, &s.y);
+
+	ecc_25519_scalarmult_begin(&s.finish_state, &s.n, &s.P);
+	while (!ecc_25519_scalarmult_step(&s.finish_state, 256)) {}
+
+	s.queue = ecc_25519_queue_new(1, 1);
+	s.pool = ecc_25519_pool_new(64, ECC_25519_FORMAT_ED25519, bench_random, &pool_counter);
+	if (!s.queue || !s.pool) {
+		fprintf(stderr, "unable to create queue or pool\n");
+		exit(1);
+	}
+
+	s.job.secret = s.n;
+	s.job.peer = s.packed_ed25519;
+	s.job.format = ECC_25519_FORMAT_ED25519;
+
+	s.points[0] = s.P;
+	for (i = 1; i < 64; i++)
+		ecc_25519_add(&s.points[i], &s.points[i-1], &s.Q);
+
+	ecc_25519_store_packed_ed25519_batch(s.packed_ed25519_array, s.points, 64);
+	ecc_25519_transcode_packed_batch(s.packed_legacy_array, NULL, s.packed_ed25519_array, 64, ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_LEGACY);
+
+	for (i = 0; i < 32; i++) {
+		s.a[i] = s.P.X[i];
+		s.b[i] = s.P.Y[i];
+	}
+}
+
+static void measure(result_t *res, const op_t *op, unsigned samples) {
+	double *ns = calloc(samples, sizeof(double));
+	double *cycles = calloc(samples, sizeof(double));
+	uint64_t t, c;
+	unsigned i, j, iterations;
+
+	if (!ns || !cycles) {
+		perror("calloc");
+		exit(1);
+	}
+
+	/* Warm up and estimate the number of iterations per sample */
+	t = now_ns();
+	op->run();
+	t = now_ns() - t;
+
+	iterations = SAMPLE_NS / (t + 1);
+	if (iterations < 1)
+		iterations = 1;
+	if (iterations > 1000000)
+		iterations = 1000000;
+
+	for (i = 0; i < samples; i++) {
+		t = now_ns();
+		c = now_cycles();
+
+		for (j = 0; j < iterations; j++) {
+			op->run();
+			__asm__ __volatile__("" ::: "memory");
+		}
+
+		c = now_cycles() - c;
+		t = now_ns() - t;
+
+		ns[i] = (double)t / iterations;
+		cycles[i] = (double)c / iterations;
+	}
+
+	qsort(ns, samples, sizeof(double), compare_double);
+	qsort(cycles, samples, sizeof(double), compare_double);
+
+	res->name = op->name;
+	res->iterations = iterations;
+	res->samples = samples;
+	res->median = percentile(ns, samples, 50);
+	res->p10 = percentile(ns, samples, 10);
+	res->p90 = percentile(ns, samples, 90);
+	res->cycles = percentile(cycles, samples, 50);
+
+	free(ns);
+	free(cycles);
+}
+
+/** Measures the throughput of ecc_25519_scalarmult_batch_workers, returning the median number of multiplications per second */
+static double measure_batch(unsigned threads, size_t batch, unsigned samples) {
+	ecc_25519_work_t *base = calloc(batch, sizeof(*base)), *out = calloc(batch, sizeof(*out));
+	ecc_int256_t *n = calloc(batch, sizeof(*n));
+	double *rate = calloc(samples, sizeof(double)), ret;
+	ecc_25519_workers_t *workers = ecc_25519_workers_new(threads);
+	uint64_t t;
+	unsigned i;
+	size_t j;
+
+	if (!base || !out || !n || !rate || !workers) {
+		perror("calloc");
+		exit(1);
+	}
+
+	for (j = 0; j < batch; j++) {
+		n[j] = s.n;
+		n[j].p[0] ^= j;
+		base[j] = s.P;
+	}
+
+	for (i = 0; i < samples; i++) {
+		t = now_ns();
+		ecc_25519_scalarmult_batch_workers(workers, out, n, base, batch);
+		t = now_ns() - t;
+
+		rate[i] = batch * 1e9 / t;
+	}
+
+	qsort(rate, samples, sizeof(double), compare_double);
+	ret = percentile(rate, samples, 50);
+
+	ecc_25519_workers_free(workers);
+	free(base);
+	free(out);
+	free(n);
+	free(rate);
+
+	return ret;
+}
+
+static void usage(const char *argv0) {
+	fprintf(stderr, "Usage: %s [-j] [-s samples] [-t threads] [-b batch size] [filter]\n", argv0);
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	const unsigned n_ops = sizeof(ops) / sizeof(ops[0]);
+	unsigned samples = 21, max_threads = 0, threads, n_results = 0, i;
+	size_t batch = 64;
+	const char *filter = NULL;
+	int json = 0, opt;
+	double single = 0;
+	result_t results[sizeof(ops) / sizeof(ops[0])];
+
+	while ((opt = getopt(argc, argv, "js:t:b:")) != -1) {
+		switch (opt) {
+		case 'j':
+			json = 1;
+			break;
+
+		case 's':
+			samples = atoi(optarg);
+			break;
+
+		case 't':
+			max_threads = atoi(optarg);
+			break;
+
+		case 'b':
+			batch = atoi(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind < argc)
+		filter = argv[optind++];
+
+	if (optind < argc || samples < 1 || batch < 1)
+		usage(argv[0]);
+
+	init_inputs();
+
+	for (i = 0; i < n_ops; i++) {
+		if (filter && !strstr(ops[i].name, filter))
+			continue;
+
+		measure(&results[n_results], &ops[i], samples);
+
+		if (!json) {
+			const result_t *r = &results[n_results];
+
+			if (!n_results)
+				printf("%-34s %12s %12s %12s %12s %12s\n", "operation", "ns/op", "p10", "p90", "cycles/op", "ops/s");
+
+			printf("%-34s %12.1f %12.1f %12.1f %12.0f %12.1f\n", r->name, r->median, r->p10, r->p90, r->cycles, 1e9 / r->median);
+		}
+
+		n_results++;
+	}
+
+	if (json) {
+		printf("{\n  \"results\": [");
+
+		for (i = 0; i < n_results; i++) {
+			const result_t *r = &results[i];
+
+			printf("%s\n    {\"name\": \"%s\", \"iterations\": %u, \"samples\": %u, "
+			       "\"ns_per_op\": {\"median\": %.2f, \"p10\": %.2f, \"p90\": %.2f}, ",
+			       i ? "," : "", r->name, r->iterations, r->samples, r->median, r->p10, r->p90);
+
+#ifdef HAVE_RDTSC
+			printf("\"cycles_per_op\": %.0f, ", r->cycles);
+#else
+			printf("\"cycles_per_op\": null, ");
+#endif
+
+			printf("\"ops_per_sec\": %.2f}", 1e9 / r->median);
+		}
+
+		printf("\n  ],\n  \"scaling\": [");
+	}
+	else if (max_threads) {
+		printf("\necc_25519_scalarmult_batch_workers, %lu multiplications per batch\n", (unsigned long)batch);
+		printf("%-8s %12s %12s\n", "threads", "ops/s", "speedup");
+	}
+
+	threads = 1;
+	while (max_threads) {
+		double rate = measure_batch(threads, batch, samples < 5 ? samples : 5);
+
+		if (threads == 1)
+			single = rate;
+
+		if (json)
+			printf("%s\n    {\"threads\": %u, \"batch\": %lu, \"ops_per_sec\": %.2f, \"speedup\": %.3f}",
+			       threads == 1 ? "" : ",", threads, (unsigned long)batch, rate, rate / single);
+		else
+			printf("%-8u %12.1f %12.3f\n", threads, rate, rate / single);
+
+		if (threads == max_threads)
+			break;
+
+		threads = (threads*2 < max_threads) ? threads*2 : max_threads;
+	}
+
+	if (json)
+		printf("\n  ]\n}\n");
+
+	ecc_25519_pool_free(s.pool);
+	ecc_25519_queue_free(s.queue);
+
+	return 0;
+}
@@ -31,7 +31,19 @@
 #define DEPRECATED __attribute__((deprecated))
 #endif
 
+/*
+ * When UECC_STATIC_INLINE is defined, all functions are declared static inline, so the amalgamated
+ * source uecc_all.c (built by the amalgamation target) can be included into a translation unit and
+ * the functions can be inlined into the caller. uecc_all.c must be included in the same translation unit then.
+ */
+#ifdef UECC_STATIC_INLINE
+#define UECC_API static inline
+#else
+#define UECC_API
+#endif
 
+
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -45,6 +57,17 @@ typedef union _ecc_int256 {
 	uint8_t p[32];
 } ecc_int256_t;
 
+/**
+ * An element of the prime field \f$ F_q \f$ in Montgomery representation
+ *
+ * Values of this type allow chaining multiplications without converting back from the
+ * Montgomery representation after each step. The members are internal; values must be converted
+ * using \ref ecc_25519_gf_mont_to and \ref ecc_25519_gf_mont_from.
+ */
+typedef struct _ecc_25519_gf_mont {
+	uint8_t m[32];
+} ecc_25519_gf_mont_t;
+
 /**
  * A point on the curve unpacked for efficient calculation
  *
@@ -58,6 +81,153 @@ typedef struct _ecc_25519_work {
 	uint32_t T[32];
 } ecc_25519_work_t;
 
+/**
+ * A point on the curve unpacked for efficient calculation, in compact storage format
+ *
+ * This holds the same value as an \ref ecc_25519_work_t, but uses only a quarter of the memory,
+ * as only a single byte is stored for each of the integer parts of the coordinates. It should be used
+ * when a large number of points needs to be kept in memory, for example for tables of precomputed points.
+ *
+ * Points must be converted using \ref ecc_25519_store_compact and \ref ecc_25519_load_compact before
+ * they can be used for calculation.
+ */
+typedef struct _ecc_25519_work_compact {
+	uint8_t X[32];
+	uint8_t Y[32];
+	uint8_t Z[32];
+	uint8_t T[32];
+} ecc_25519_work_compact_t;
+
+/** The packed representations supported by libuecc */
+typedef enum _ecc_25519_format {
+	/** The packed representation used by \ref ecc_25519_load_packed_ed25519 and \ref ecc_25519_store_packed_ed25519 */
+	ECC_25519_FORMAT_ED25519,
+	/** The packed representation used by \ref ecc_25519_load_packed_legacy and \ref ecc_25519_store_packed_legacy */
+	ECC_25519_FORMAT_LEGACY,
+	/** The packed representation used by \ref ecc_25519_load_packed_ristretto255 and \ref ecc_25519_store_packed_ristretto255 */
+	ECC_25519_FORMAT_RISTRETTO255,
+	/** The u coordinate of the Montgomery form as used by X25519, see \ref ecc_25519_load_packed_montgomery and \ref ecc_25519_store_packed_montgomery */
+	ECC_25519_FORMAT_MONTGOMERY,
+} ecc_25519_format_t;
+
+/**
+ * A Diffie-Hellman job for \ref ecc_25519_queue_submit
+ *
+ * A job computes the same result as \ref ecc_25519_ecdh_packed.
+ */
+typedef struct _ecc_25519_job {
+	/** The secret key; it is wiped when the job is finished */
+	ecc_int256_t secret;
+	/** The packed public key of the peer */
+	ecc_int256_t peer;
+	/** The format of \ref peer and \ref result */
+	ecc_25519_format_t format;
+	/** Arbitrary user data that is returned with the finished job */
+	void *tag;
+
+	/** The packed result; set when the job is finished */
+	ecc_int256_t result;
+	/** The return value of \ref ecc_25519_ecdh_packed for the job; set when the job is finished */
+	int status;
+} ecc_25519_job_t;
+
+/** A queue processing \ref ecc_25519_job_t in the background (opaque) */
+typedef struct _ecc_25519_queue ecc_25519_queue_t;
+
+/** A set of threads for \ref ecc_25519_scalarmult_batch_workers (opaque) */
+typedef struct _ecc_25519_workers ecc_25519_workers_t;
+
+/**
+ * A table of precomputed multiples of a fixed base point, see \ref ecc_25519_fixed_base_init
+ *
+ * The members are internal. A table takes 32KB of memory.
+ */
+typedef struct _ecc_25519_fixed_base {
+	uint8_t entries[32][8][128];
+} ecc_25519_fixed_base_t;
+
+/** An ephemeral keypair taken from a pool, see \ref ecc_25519_pool_get */
+typedef struct _ecc_25519_keypair {
+	/** The secret key, already processed by \ref ecc_25519_gf_sanitize_secret */
+	ecc_int256_t secret;
+	/** The public key, i.e. the product of the secret key and the default base point */
+	ecc_25519_work_t work;
+	/** The public key in the packed format of the pool */
+	ecc_int256_t packed;
+} ecc_25519_keypair_t;
+
+/** A pool of ephemeral keypairs generated in the background (opaque) */
+typedef struct _ecc_25519_pool ecc_25519_pool_t;
+
+/** The number of points normalized together by \ref ecc_25519_enum_next */
+#define ECC_25519_ENUM_BLOCK 64
+
+/**
+ * The state of an enumeration of points, see \ref ecc_25519_enum_init
+ *
+ * The members are internal; the block space is used by \ref ecc_25519_enum_next to batch
+ * the normalization of the points. As the state is rather large (about 6.5KB), it may be
+ * preferable to allocate it on the heap on systems with small stacks.
+ */
+typedef struct _ecc_25519_enum {
+	ecc_25519_work_t cur;
+	ecc_25519_work_t step;
+	uint8_t block[ECC_25519_ENUM_BLOCK][3][32];
+} ecc_25519_enum_t;
+
+/**
+ * The state of a scalar multiplication done in steps, see \ref ecc_25519_scalarmult_begin
+ *
+ * The members are internal. Note that the state contains the scalar.
+ */
+typedef struct _ecc_25519_scalarmult_state {
+	ecc_int256_t n;
+	ecc_25519_work_t base;
+	uint32_t u[32], v[32];
+	uint32_t X2[32], Z2[32], X3[32], Z3[32];
+	uint32_t swap;
+	unsigned bits, pos;
+} ecc_25519_scalarmult_state_t;
+
+/** Flag for \ref ecc_25519_ctx_init: keep a table for \ref ecc_25519_scalarmult_fixed of the default base point in the arena */
+#define ECC_25519_CTX_BASE_TABLE 1
+
+/**
+ * A context with preallocated memory for the _ctx functions, see \ref ecc_25519_ctx_init
+ *
+ * The members are internal; they point into the arena provided by the caller. A context must
+ * only be used by one thread at a time.
+ */
+typedef struct _ecc_25519_ctx {
+	ecc_25519_fixed_base_t *base_table;
+	uint8_t *scratch;
+	size_t batch;
+} ecc_25519_ctx_t;
+
+/**
+ * Counters of the internal prime field operations
+ *
+ * See \ref ecc_25519_stats_get.
+ */
+typedef struct _ecc_25519_stats {
+	/** Multiplications modulo \f$ 2^{255} - 19 \f$ */
+	uint64_t mult;
+	/** Multiplications with small integers modulo \f$ 2^{255} - 19 \f$ */
+	uint64_t mult_int;
+	/** Squarings modulo \f$ 2^{255} - 19 \f$ */
+	uint64_t square;
+	/** Carry and reduce steps modulo \f$ 2^{255} - 19 \f$ (including the ones done by multiplications and squarings) */
+	uint64_t squeeze;
+	/** Reciprocals modulo \f$ 2^{255} - 19 \f$ */
+	uint64_t recip;
+	/** Square roots modulo \f$ 2^{255} - 19 \f$ */
+	uint64_t square_root;
+	/** Reductions modulo the group order */
+	uint64_t gf_reduce;
+	/** Montgomery multiplications modulo the group order */
+	uint64_t gf_montgomery;
+} ecc_25519_stats_t;
+
 /**
  * \defgroup curve_ops Operations on points of the Elliptic Curve
  * @{
@@ -92,21 +262,21 @@ extern const ecc_25519_work_t ecc_25519_work_default_base;
 
 
 /** Loads a point of the Ed25519 curve with given coordinates into its unpacked representation */
-int ecc_25519_load_xy_ed25519(ecc_25519_work_t *out, const ecc_int256_t *x, const ecc_int256_t *y);
+UECC_API int ecc_25519_load_xy_ed25519(ecc_25519_work_t *out, const ecc_int256_t *x, const ecc_int256_t *y);
 
 /**
  * Loads a point of the legacy curve with given coordinates into its unpacked representation
  *
  * New software should use \ref ecc_25519_load_xy_ed25519, which uses the same curve as the Ed25519 algorithm.
  */
-int ecc_25519_load_xy_legacy(ecc_25519_work_t *out, const ecc_int256_t *x, const ecc_int256_t *y);
+UECC_API int ecc_25519_load_xy_legacy(ecc_25519_work_t *out, const ecc_int256_t *x, const ecc_int256_t *y);
 
 /**
  * Loads a point of the legacy curve with given coordinates into its unpacked representation
  *
  * \deprecated Use \ref ecc_25519_load_xy_legacy
  */
-DEPRECATED int ecc_25519_load_xy(ecc_25519_work_t *out, const ecc_int256_t *x, const ecc_int256_t *y);
+DEPRECATED UECC_API int ecc_25519_load_xy(ecc_25519_work_t *out, const ecc_int256_t *x, const ecc_int256_t *y);
 
 
 /**
@@ -116,7 +286,7 @@ DEPRECATED int ecc_25519_load_xy(ecc_25519_work_t *out, const ecc_int256_t *x, c
  * \param y Returns the y coordinate of the point. May be NULL.
  * \param in The unpacked point to store.
  */
-void ecc_25519_store_xy_ed25519(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t *in);
+UECC_API void ecc_25519_store_xy_ed25519(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t *in);
 
 /**
  * Stores the x and y coordinates of a point of the legacy curve
@@ -127,7 +297,7 @@ void ecc_25519_store_xy_ed25519(ecc_int256_t *x, ecc_int256_t *y, const ecc_2551
  * \param y Returns the y coordinate of the point. May be NULL.
  * \param in The unpacked point to store.
  */
-void ecc_25519_store_xy_legacy(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t *in);
+UECC_API void ecc_25519_store_xy_legacy(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t *in);
 
 /**
  * Stores a point's x and y coordinates
@@ -138,7 +308,7 @@ void ecc_25519_store_xy_legacy(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519
  *
  * \deprecated Use \ref ecc_25519_store_xy_legacy
  */
-DEPRECATED void ecc_25519_store_xy(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t *in);
+DEPRECATED UECC_API void ecc_25519_store_xy(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t *in);
 
 
 /**
@@ -147,7 +317,7 @@ DEPRECATED void ecc_25519_store_xy(ecc_int256_t *x, ecc_int256_t *y, const ecc_2
  * The packed format is different from the legacy one: the legacy format contains that X coordinate and the parity of the Y coordinate,
  * Ed25519 uses the Y coordinate and the parity of the X coordinate.
 */
-int ecc_25519_load_packed_ed25519(ecc_25519_work_t *out, const ecc_int256_t *in);
+UECC_API int ecc_25519_load_packed_ed25519(ecc_25519_work_t *out, const ecc_int256_t *in);
 
 /**
  * Loads a packed point of the legacy curve into its unpacked representation
@@ -157,14 +327,14 @@ int ecc_25519_load_packed_ed25519(ecc_25519_work_t *out, const ecc_int256_t *in)
  * The packed format is different from the Ed25519 one: the legacy format contains that X coordinate and the parity of the Y coordinate,
  * Ed25519 uses the Y coordinate and the parity of the X coordinate.
  */
-int ecc_25519_load_packed_legacy(ecc_25519_work_t *out, const ecc_int256_t *in);
+UECC_API int ecc_25519_load_packed_legacy(ecc_25519_work_t *out, const ecc_int256_t *in);
 
 /**
  * Loads a packed point of the legacy curve into its unpacked representation
  *
  * \deprecated Use \ref ecc_25519_load_packed_legacy
  */
-DEPRECATED int ecc_25519_load_packed(ecc_25519_work_t *out, const ecc_int256_t *in);
+DEPRECATED UECC_API int ecc_25519_load_packed(ecc_25519_work_t *out, const ecc_int256_t *in);
 
 
 /**
@@ -173,7 +343,7 @@ DEPRECATED int ecc_25519_load_packed(ecc_25519_work_t *out, const ecc_int256_t *
  * The packed format is different from the Ed25519 one: the legacy format contains that X coordinate and the parity of the Y coordinate,
  * Ed25519 uses the Y coordinate and the parity of the X coordinate.
  */
-void ecc_25519_store_packed_ed25519(ecc_int256_t *out, const ecc_25519_work_t *in);
+UECC_API void ecc_25519_store_packed_ed25519(ecc_int256_t *out, const ecc_25519_work_t *in);
 
 /**
  * Stores a point of the legacy curve into its packed representation
@@ -183,25 +353,171 @@ void ecc_25519_store_packed_ed25519(ecc_int256_t *out, const ecc_25519_work_t *i
  * The packed format is different from the Ed25519 one: the legacy format contains that X coordinate and the parity of the Y coordinate,
  * Ed25519 uses the Y coordinate and the parity of the X coordinate.
  */
-void ecc_25519_store_packed_legacy(ecc_int256_t *out, const ecc_25519_work_t *in);
+UECC_API void ecc_25519_store_packed_legacy(ecc_int256_t *out, const ecc_25519_work_t *in);
 
 /**
  * Stores a point of the legacy curve into its packed representation
  *
  * \deprecated Use \ref ecc_25519_store_packed_legacy
  */
-DEPRECATED void ecc_25519_store_packed(ecc_int256_t *out, const ecc_25519_work_t *in);
+DEPRECATED UECC_API void ecc_25519_store_packed(ecc_int256_t *out, const ecc_25519_work_t *in);
+
+/**
+ * Stores an array of points of the Ed25519 curve into their packed representations
+ *
+ * The result is the same as calling \ref ecc_25519_store_packed_ed25519 for each point, but only a single
+ * reciprocal is computed for the whole array, making this much faster for large arrays. As the packed
+ * representation is unique, it can be used to hash or deduplicate sets of points.
+ *
+ * No additional memory is needed; the output array must not overlap with the input.
+ */
+UECC_API void ecc_25519_store_packed_ed25519_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count);
+
+/**
+ * Stores an array of points of the Ed25519 curve into their packed representations in the legacy format
+ *
+ * This works like \ref ecc_25519_store_packed_ed25519_batch; the result is the same as calling
+ * \ref ecc_25519_store_packed_legacy for each point.
+ */
+UECC_API void ecc_25519_store_packed_legacy_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count);
+
+/**
+ * Stores the u coordinates of the Montgomery form of an array of points of the Ed25519 curve
+ *
+ * This works like \ref ecc_25519_store_packed_ed25519_batch; the result is the same as calling
+ * \ref ecc_25519_store_packed_montgomery for each point (so the identity element is stored as u = 0).
+ */
+UECC_API void ecc_25519_store_packed_montgomery_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count);
+
+
+/**
+ * Loads the u coordinate of the Montgomery form of the Ed25519 curve (as used by X25519) into an unpacked point
+ *
+ * The u coordinate doesn't determine the sign of the x coordinate of the Ed25519 curve; the point with even x
+ * is loaded. Like in X25519, the highest bit of the input is ignored.
+ *
+ * Returns 0 if the input isn't the u coordinate of a point of the curve (but of its twist), 1 otherwise.
+ */
+UECC_API int ecc_25519_load_packed_montgomery(ecc_25519_work_t *out, const ecc_int256_t *in);
+
+/**
+ * Stores the u coordinate of the Montgomery form of a point of the Ed25519 curve (as used by X25519)
+ *
+ * The identity element is stored as u = 0.
+ */
+UECC_API void ecc_25519_store_packed_montgomery(ecc_int256_t *out, const ecc_25519_work_t *in);
+
+/**
+ * Converts an array of packed points between two formats
+ *
+ * For valid inputs, the result is the same as loading and storing each point, but the conversions need at
+ * most a single square root per point, and reciprocals are shared between points:
+ *
+ * - Conversions between the Ed25519 and the legacy format need a square root per point, but no reciprocal.
+ * - Conversions from the Ed25519 to the Montgomery format and back need neither square roots nor checks
+ *   of the input, so the output is undefined for inputs not representing a point of the curve. All other
+ *   conversions check their input. A single reciprocal is shared between 16 points.
+ * - Conversions from the legacy to the Montgomery format and back need a square root per point and share
+ *   the reciprocals like above.
+ *
+ * Points converted from the Montgomery format get the sign of the x coordinate like \ref ecc_25519_load_packed_montgomery.
+ *
+ * If status isn't NULL, status[i] is set to 1 if in[i] was converted successfully, and to 0 if it was invalid
+ * (out[i] is set to zero then). The number of successfully converted points is returned.
+ *
+ * \warning As the conversions from the Ed25519 to the Montgomery format and back don't check their input,
+ *          status and the return value don't detect invalid points in these directions: from the Ed25519 format,
+ *          all inputs are reported as converted successfully, and from the Montgomery format, only u = -1 (which
+ *          can't be converted at all) is reported as invalid. Load the points if they need to be validated.
+ */
+UECC_API size_t ecc_25519_transcode_packed_batch(ecc_int256_t *out, int *status, const ecc_int256_t *in, size_t count, ecc_25519_format_t from, ecc_25519_format_t to);
+
+
+/**
+ * Loads a Ristretto255 encoded group element into an unpacked point of the Ed25519 curve
+ *
+ * Ristretto255 is a prime order group built from the Ed25519 curve: each group element is represented by
+ * four points of the curve, which differ by a point of order 4 and have the same unique encoding. Points loaded
+ * from a Ristretto255 encoding need neither cofactor clearing nor subgroup checks; decoding needs a single exponentiation.
+ *
+ * Returns 0 if the input isn't a valid canonical encoding, 1 otherwise.
+ */
+UECC_API int ecc_25519_load_packed_ristretto255(ecc_25519_work_t *out, const ecc_int256_t *in);
+
+/**
+ * Stores a point of the Ed25519 curve as a Ristretto255 encoded group element
+ *
+ * Only points in the prime order subgroup (plus a point of order 4) represent a Ristretto255 group element,
+ * like the ones loaded using \ref ecc_25519_load_packed_ristretto255 or \ref ecc_25519_ristretto255_from_uniform,
+ * the multiples of \ref ecc_25519_work_default_base, and points computed from those.
+ */
+UECC_API void ecc_25519_store_packed_ristretto255(ecc_int256_t *out, const ecc_25519_work_t *in);
+
+/**
+ * Checks if two points represent the same Ristretto255 group element
+ *
+ * This is faster than comparing the encodings.
+ */
+UECC_API int ecc_25519_ristretto255_equal(const ecc_25519_work_t *in1, const ecc_25519_work_t *in2);
+
+/**
+ * Maps 64 uniformly distributed bytes (e.g., the output of a hash function) to a Ristretto255 group element
+ *
+ * The discrete logarithm of the result with respect to any other point is unknown.
+ */
+UECC_API void ecc_25519_ristretto255_from_uniform(ecc_25519_work_t *out, const uint8_t in[64]);
+
+
+/**
+ * Stores an unpacked point in compact storage format
+ *
+ * Unlike the packed representation, the compact representation isn't unique and storing a point in
+ * compact format doesn't need any expensive calculations.
+ */
+UECC_API void ecc_25519_store_compact(ecc_25519_work_compact_t *out, const ecc_25519_work_t *in);
+
+/** Loads a point stored in compact format back into its unpacked representation */
+UECC_API void ecc_25519_load_compact(ecc_25519_work_t *out, const ecc_25519_work_compact_t *in);
 
 
 /** Checks if a point is the identity element of the Elliptic Curve group */
-int ecc_25519_is_identity(const ecc_25519_work_t *in);
+UECC_API int ecc_25519_is_identity(const ecc_25519_work_t *in);
+
+/**
+ * Checks if two unpacked points are the same point of the Elliptic Curve
+ *
+ * The check uses cross-multiplication with the Z coordinates, so it doesn't need a reciprocal
+ * like comparing the packed representations. Its runtime is independent of the inputs.
+ */
+UECC_API int ecc_25519_equal(const ecc_25519_work_t *in1, const ecc_25519_work_t *in2);
+
+/**
+ * Checks if a point has small order
+ *
+ * A point has small order if its order divides the cofactor 8. Multiplying such a point with a
+ * secret key multiple of 8 (see \ref ecc_25519_gf_sanitize_secret) yields the identity element,
+ * so public keys of small order should be rejected.
+ *
+ * This function runs in constant time.
+ */
+UECC_API int ecc_25519_is_small_order(const ecc_25519_work_t *in);
+
+/**
+ * Checks if a point is element of the prime order subgroup generated by the default base point
+ *
+ * This is the case if multiplying the point with the order \ref ecc_25519_gf_order yields
+ * the identity element.
+ *
+ * This function doesn't run in constant time and must only be used with public points.
+ */
+UECC_API int ecc_25519_in_prime_subgroup(const ecc_25519_work_t *in);
 
 /**
  * Negates a point of the Elliptic Curve
  *
  * The same pointer may be given for input and output
  */
-void ecc_25519_negate(ecc_25519_work_t *out, const ecc_25519_work_t *in);
+UECC_API void ecc_25519_negate(ecc_25519_work_t *out, const ecc_25519_work_t *in);
 
 /**
  * Doubles a point of the Elliptic Curve
@@ -210,21 +526,21 @@ void ecc_25519_negate(ecc_25519_work_t *out, const ecc_25519_work_t *in);
  *
  * The same pointer may be given for input and output.
  */
-void ecc_25519_double(ecc_25519_work_t *out, const ecc_25519_work_t *in);
+UECC_API void ecc_25519_double(ecc_25519_work_t *out, const ecc_25519_work_t *in);
 
 /**
  * Adds two points of the Elliptic Curve
  *
  * The same pointers may be given for input and output.
  */
-void ecc_25519_add(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2);
+UECC_API void ecc_25519_add(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2);
 
 /**
  * Subtracts two points of the Elliptic Curve
  *
  * The same pointers may be given for input and output.
  */
-void ecc_25519_sub(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2);
+UECC_API void ecc_25519_sub(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2);
 
 /**
  * Does a scalar multiplication of a point of the Elliptic Curve with an integer of a given bit length
@@ -233,16 +549,43 @@ void ecc_25519_sub(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc
  * are used. The bit length should always be a constant and not computed at runtime to ensure
  * that no timing attacks are possible.
  *
+ * The multiplication is done in constant time with the Montgomery ladder on the u coordinates of the
+ * equivalent Montgomery curve; the full point is recovered at the end, so the result can be used like
+ * any other work structure.
+ *
  * The same pointer may be given for input and output.
  **/
-void ecc_25519_scalarmult_bits(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base, unsigned bits);
+UECC_API void ecc_25519_scalarmult_bits(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base, unsigned bits);
 
 /**
  * Does a scalar multiplication of a point of the Elliptic Curve with an integer
  *
  * The same pointer may be given for input and output.
  **/
-void ecc_25519_scalarmult(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base);
+UECC_API void ecc_25519_scalarmult(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base);
+
+/**
+ * Does scalar multiplications of many points of the Elliptic Curve with the same integer
+ *
+ * For each i in \f$ [0, count) \f$, out[i] is set to the product of n and bases[i]. The bases are processed in
+ * pairs with interleaved Montgomery ladders like in \ref ecc_25519_scalarmult_x2, and their conversions to the
+ * Montgomery curve share a single reciprocal, so this is faster than calling \ref ecc_25519_scalarmult for each
+ * base. The multiplications run in constant time.
+ *
+ * The output array may be the same as the bases array, but must not overlap otherwise.
+ */
+UECC_API void ecc_25519_scalarmult_many(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *bases, size_t count);
+
+/**
+ * Computes \f$ n_1 \cdot P_1 + n_2 \cdot P_2 \f$ for two points of the Elliptic Curve
+ *
+ * Both multiplications are done at the same time with shared doublings, so this is considerably faster than
+ * two calls of \ref ecc_25519_scalarmult followed by \ref ecc_25519_add. It runs in constant time.
+ *
+ * The same pointers may be given for input and output.
+ */
+UECC_API void ecc_25519_scalarmult_joint(ecc_25519_work_t *out, const ecc_int256_t *n1, const ecc_25519_work_t *base1,
+					 const ecc_int256_t *n2, const ecc_25519_work_t *base2);
 
 /**
  * Does a scalar multiplication of the default base point (generator element) of the Elliptic Curve with an integer of a given bit length
@@ -253,7 +596,7 @@ void ecc_25519_scalarmult(ecc_25519_work_t *out, const ecc_int256_t *n, const ec
  *
  * See the notes about \ref ecc_25519_scalarmult_bits before using this function.
  */
-void ecc_25519_scalarmult_base_bits(ecc_25519_work_t *out, const ecc_int256_t *n, unsigned bits);
+UECC_API void ecc_25519_scalarmult_base_bits(ecc_25519_work_t *out, const ecc_int256_t *n, unsigned bits);
 
 /**
  * Does a scalar multiplication of the default base point (generator element) of the Elliptic Curve with an integer
@@ -262,7 +605,367 @@ void ecc_25519_scalarmult_base_bits(ecc_25519_work_t *out, const ecc_int256_t *n
  *
  * ecc_25519_scalarmult_base(out, n) is faster than ecc_25519_scalarmult(out, n, &ecc_25519_work_default_base).
  */
-void ecc_25519_scalarmult_base(ecc_25519_work_t *out, const ecc_int256_t *n);
+UECC_API void ecc_25519_scalarmult_base(ecc_25519_work_t *out, const ecc_int256_t *n);
+
+/**
+ * Starts a scalar multiplication that is done in steps
+ *
+ * Together with \ref ecc_25519_scalarmult_step and \ref ecc_25519_scalarmult_finish, this computes the same
+ * result as \ref ecc_25519_scalarmult, but the work can be split into slices of bounded duration (for example
+ * to interleave it with other work in an event loop). Each of the 256 bits of the integer takes one step
+ * of the Montgomery ladder; beginning and finishing take about as long as a few steps each. The multiplication
+ * runs in constant time as long as the slice sizes don't depend on secret data.
+ *
+ * The state doesn't reference n or base after this call.
+ */
+UECC_API void ecc_25519_scalarmult_begin(ecc_25519_scalarmult_state_t *state, const ecc_int256_t *n, const ecc_25519_work_t *base);
+
+/**
+ * Continues a scalar multiplication started with \ref ecc_25519_scalarmult_begin, processing up to max_bits bits of the integer
+ *
+ * Returns 1 if all bits have been processed, so \ref ecc_25519_scalarmult_finish won't need to do any steps anymore,
+ * and 0 otherwise.
+ */
+UECC_API int ecc_25519_scalarmult_step(ecc_25519_scalarmult_state_t *state, unsigned max_bits);
+
+/**
+ * Finishes a scalar multiplication started with \ref ecc_25519_scalarmult_begin
+ *
+ * All remaining bits of the integer are processed first. The state can't be used anymore afterwards
+ * (except for starting a new multiplication).
+ */
+UECC_API void ecc_25519_scalarmult_finish(ecc_25519_scalarmult_state_t *state, ecc_25519_work_t *out);
+
+/**
+ * Does two independent scalar multiplications of points of the Elliptic Curve with integers
+ *
+ * The results are the same as the ones of two calls of \ref ecc_25519_scalarmult, but the operations of both
+ * multiplications are interleaved, so CPUs executing multiple instructions in parallel can work on both at
+ * the same time, which is usually faster. The multiplications run in constant time.
+ *
+ * The same pointers may be given for inputs and outputs.
+ */
+UECC_API void ecc_25519_scalarmult_x2(ecc_25519_work_t *out1, const ecc_int256_t *n1, const ecc_25519_work_t *base1,
+				      ecc_25519_work_t *out2, const ecc_int256_t *n2, const ecc_25519_work_t *base2);
+
+/**
+ * Precomputes a table of multiples of a fixed base point for \ref ecc_25519_scalarmult_fixed
+ *
+ * The base point must be in the prime order subgroup (like the default base point is), as the scalars are
+ * reduced modulo the group order by the functions using the table. Computing a table takes about as long as
+ * two scalar multiplications.
+ */
+UECC_API void ecc_25519_fixed_base_init(ecc_25519_fixed_base_t *table, const ecc_25519_work_t *base);
+
+/**
+ * Does a scalar multiplication of a fixed base point with an integer, using a precomputed table
+ *
+ * The integer is reduced modulo the group order. This is considerably faster than \ref ecc_25519_scalarmult
+ * and \ref ecc_25519_scalarmult_base, and is done in constant time as well.
+ */
+UECC_API void ecc_25519_scalarmult_fixed(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_fixed_base_t *table);
+
+/**
+ * Computes \f$ n_1 \cdot P_1 + n_2 \cdot P_2 \f$ for two fixed base points \f$ P_1 \f$ and \f$ P_2 \f$ given by precomputed tables
+ *
+ * This is useful for commitments and key blinding, which need \f$ a \cdot B + b \cdot H \f$ for secret a and b.
+ * Both tables are looked up for each digit of the integers, and the doublings are shared, so this is much faster than
+ * two scalar multiplications followed by \ref ecc_25519_add, and is done in constant time as well. The integers are
+ * reduced modulo the group order.
+ */
+UECC_API void ecc_25519_scalarmult_fixed_joint(ecc_25519_work_t *out, const ecc_int256_t *n1, const ecc_25519_fixed_base_t *table1,
+					       const ecc_int256_t *n2, const ecc_25519_fixed_base_t *table2);
+
+/**
+ * Starts an enumeration of the points \f$ (s + i \cdot k) \cdot B \f$ for \f$ i = 0, 1, 2, \ldots \f$
+ *
+ * \f$ B \f$ is the default base point, \f$ s \f$ is given as start and \f$ k \f$ as step.
+ * This allows to scan ranges of derived keys (for example for vanity public keys) much faster than with
+ * independent calls of \ref ecc_25519_scalarmult_base and \ref ecc_25519_store_packed_ed25519.
+ *
+ * Note that \ref ecc_25519_gf_sanitize_secret clears the lowest three bits of a secret, so the step
+ * should be a multiple of 8 when the secrets of the enumerated points are to be used unchanged.
+ */
+UECC_API void ecc_25519_enum_init(ecc_25519_enum_t *e, const ecc_int256_t *start, const ecc_int256_t *step);
+
+/**
+ * Stores the next count points of an enumeration in the given packed format and advances it
+ *
+ * Each point takes a single point addition; for all formats except Ristretto255, the points are then
+ * normalized in blocks of \ref ECC_25519_ENUM_BLOCK using a single reciprocal per block.
+ *
+ * The enumeration isn't done in constant time with respect to count and format.
+ */
+UECC_API void ecc_25519_enum_next(ecc_25519_enum_t *e, ecc_int256_t *out, size_t count, ecc_25519_format_t format);
+
+/**
+ * Does a scalar multiplication of a point of the Elliptic Curve with an integer in variable time
+ *
+ * \warning The runtime and memory access pattern of this function depend on n and base,
+ *          so it must never be used with secret inputs (like private keys or nonces).
+ *
+ * Using a width-5 non-adjacent form of n, only about every sixth doubling is followed by a mixed
+ * addition of a precomputed multiple of base. As most of the time is spent in the doublings, this is
+ * only slightly faster than the Montgomery ladder of \ref ecc_25519_scalarmult for integers of full
+ * length, but leading zero bits of n are skipped. It is meant for public inputs, e.g. for signature
+ * verification or subgroup checks.
+ *
+ * The same pointer may be given for input and output.
+ */
+UECC_API void ecc_25519_scalarmult_vartime(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base);
+
+/**
+ * Computes a Diffie-Hellman shared secret from a packed public key
+ *
+ * ecc_25519_ecdh_packed(out, secret, peer, format) computes the same result as loading peer with
+ * the load function of the given format (e.g. \ref ecc_25519_load_packed_ed25519), multiplying it with secret using
+ * \ref ecc_25519_scalarmult and storing the result in the same packed format.
+ *
+ * Only \ref ECC_25519_FORMAT_MONTGOMERY has a fused implementation, which is faster than these steps: like X25519,
+ * it runs the Montgomery ladder on the u coordinate of peer directly, so peer isn't decompressed. As a consequence,
+ * u coordinates of points of the twist of the curve aren't rejected; the twist has a large prime order subgroup as well.
+ *
+ * For the Ed25519, legacy and Ristretto255 formats, this function just does the load, the check for a small order,
+ * the scalar multiplication and the store one after another, so it isn't faster than calling these functions.
+ *
+ * Returns 0 and sets out to zero if peer isn't a valid packed point or if its order is small (i.e., it divides
+ * the cofactor 8), 1 otherwise.
+ */
+UECC_API int ecc_25519_ecdh_packed(ecc_int256_t *out, const ecc_int256_t *secret, const ecc_int256_t *peer, ecc_25519_format_t format);
+
+/**
+ * Computes an FHMQV shared secret from packed public keys
+ *
+ * The result is \f$ (y + e \cdot b) \cdot (X + d \cdot A) \f$, where y and b are the own ephemeral and static secret
+ * keys, X and A are the peer's ephemeral and static public keys and e and d are the hash values of the protocol. The
+ * integers are combined modulo the group order (as with \ref ecc_25519_gf_mult and \ref ecc_25519_gf_add) and the point
+ * is computed with \ref ecc_25519_scalarmult_joint, so this is done in constant time with a single joint scalar
+ * multiplication. The result is stored in the packed format of the public keys.
+ *
+ * As the integers are reduced modulo the group order, both parties only get the same result if the public keys are in
+ * the prime order subgroup; this is always the case for the Ristretto255 format.
+ *
+ * The Montgomery format can't be used, as the sum of two points isn't determined by their u coordinates.
+ *
+ * Returns 0 and sets out to zero if the format is \ref ECC_25519_FORMAT_MONTGOMERY, if X or A isn't a valid packed point,
+ * or if the order of X, A or the result is small, 1 otherwise.
+ */
+UECC_API int ecc_25519_fhmqv_packed(ecc_int256_t *out, const ecc_int256_t *y, const ecc_int256_t *b, const ecc_int256_t *e, const ecc_int256_t *d,
+				    const ecc_int256_t *X, const ecc_int256_t *A, ecc_25519_format_t format);
+
+/**
+ * Does a batch of scalar multiplications of points of the Elliptic Curve using multiple threads
+ *
+ * For each i in \f$ [0, count) \f$, out[i] is set to the product of n[i] and base[i]. When base is NULL,
+ * the default base point is used for all multiplications, like \ref ecc_25519_scalarmult_base does.
+ *
+ * The jobs are distributed over the given number of threads, including the calling thread, which
+ * means that 1 thread will do all multiplications in the calling thread. The function returns
+ * when all multiplications have finished.
+ *
+ * The output array may be the same as the base array, but must not overlap otherwise.
+ *
+ * The threads are created when the function is called and joined before it returns. Programs
+ * doing batches regularly should keep their threads with \ref ecc_25519_workers_new and use
+ * \ref ecc_25519_scalarmult_batch_workers instead.
+ */
+UECC_API void ecc_25519_scalarmult_batch(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base, size_t count, unsigned threads);
+
+/**
+ * Creates a set of threads for batches of scalar multiplications
+ *
+ * threads is the total number of threads working on a batch; as the thread calling
+ * \ref ecc_25519_scalarmult_batch_workers does its part of the jobs, threads-1 background
+ * threads are started. The memory used by the multiplications is allocated once here.
+ *
+ * Returns NULL if memory can't be allocated.
+ */
+UECC_API ecc_25519_workers_t * ecc_25519_workers_new(unsigned threads);
+
+/** Stops the threads of a \ref ecc_25519_workers_t and frees it */
+UECC_API void ecc_25519_workers_free(ecc_25519_workers_t *workers);
+
+/**
+ * Does a batch of scalar multiplications using the threads of a \ref ecc_25519_workers_t
+ *
+ * The results are the same as for \ref ecc_25519_scalarmult_batch. Each thread starts with an equal
+ * share of the jobs; threads that have finished their share take over jobs of the others.
+ *
+ * Only one batch can be processed by the same workers at a time.
+ */
+UECC_API void ecc_25519_scalarmult_batch_workers(ecc_25519_workers_t *workers, ecc_25519_work_t *out, const ecc_int256_t *n,
+						 const ecc_25519_work_t *base, size_t count);
+
+/**@}*/
+
+/**
+ * \defgroup queue_ops Asynchronous processing of Diffie-Hellman jobs
+ *
+ * A queue allows to submit jobs from an event loop without blocking it. The jobs are
+ * processed by background threads, and finished jobs can be collected whenever the queue's
+ * file descriptor becomes readable.
+ *
+ * \ref ecc_25519_queue_submit and \ref ecc_25519_queue_poll must not be called concurrently for the
+ * same queue.
+ *
+ * @{
+ */
+
+/**
+ * Creates a new queue
+ *
+ * \param threads The number of background threads processing the jobs
+ * \param size The maximum number of jobs that may be submitted before they are collected using \ref ecc_25519_queue_poll
+ *
+ * Returns NULL when the queue can't be created.
+ */
+UECC_API ecc_25519_queue_t * ecc_25519_queue_new(unsigned threads, size_t size);
+
+/**
+ * Stops the background threads of a queue and frees it
+ *
+ * Jobs that haven't been collected yet are discarded.
+ */
+UECC_API void ecc_25519_queue_free(ecc_25519_queue_t *queue);
+
+/**
+ * Returns a file descriptor that is readable whenever there are finished jobs to collect
+ *
+ * The file descriptor must not be read from or closed by the caller, it is reset by \ref ecc_25519_queue_poll.
+ */
+UECC_API int ecc_25519_queue_fd(const ecc_25519_queue_t *queue);
+
+/**
+ * Submits a job to a queue
+ *
+ * The job is copied, so the passed structure may be reused or freed when the function returns.
+ *
+ * Returns 0 if the queue is full, 1 otherwise.
+ */
+UECC_API int ecc_25519_queue_submit(ecc_25519_queue_t *queue, const ecc_25519_job_t *job);
+
+/**
+ * Collects finished jobs from a queue
+ *
+ * Up to max finished jobs are copied to the jobs array. The secrets of returned jobs are always zero.
+ *
+ * Returns the number of returned jobs.
+ */
+UECC_API size_t ecc_25519_queue_poll(ecc_25519_queue_t *queue, ecc_25519_job_t *jobs, size_t max);
+
+/**@}*/
+
+/**
+ * \defgroup pool_ops Pools of ephemeral keypairs
+ *
+ * A pool generates keypairs ahead of demand in a low-priority background thread, so taking
+ * a fresh ephemeral key doesn't include the scalar multiplication. The pool is refilled in batches
+ * whenever it has drained to half its size.
+ *
+ * \ref ecc_25519_pool_get must not be called concurrently for the same pool.
+ *
+ * @{
+ */
+
+/**
+ * Creates a new pool and starts generating keypairs
+ *
+ * \param size The number of keypairs kept in the pool
+ * \param format The packed format of the public keys
+ * \param random A callback that fills buf with len random bytes; it must return 1 on success and 0 on failure. It
+ *        is called from the background thread only.
+ * \param random_arg An argument passed to the callback
+ *
+ * When the callback fails, the pool stops generating keypairs. Returns NULL when the pool can't be created.
+ */
+UECC_API ecc_25519_pool_t * ecc_25519_pool_new(size_t size, ecc_25519_format_t format, int (*random)(void *arg, uint8_t *buf, size_t len), void *random_arg);
+
+/**
+ * Stops the background thread of a pool and frees it
+ *
+ * The secrets of the keypairs that haven't been taken are wiped.
+ */
+UECC_API void ecc_25519_pool_free(ecc_25519_pool_t *pool);
+
+/**
+ * Takes a keypair from a pool
+ *
+ * The keypair is removed from the pool and wiped there, so each keypair is returned only once.
+ * The function never blocks.
+ *
+ * Returns 0 if the pool is empty, 1 otherwise. When the pool is empty, the caller should generate
+ * the keypair itself.
+ */
+UECC_API int ecc_25519_pool_get(ecc_25519_pool_t *pool, ecc_25519_keypair_t *keypair);
+
+/**@}*/
+
+/**
+ * \defgroup ctx_ops Contexts with preallocated memory
+ *
+ * A context divides a memory arena provided by the caller into lookup tables and scratch space
+ * for batch operations. The _ctx functions take all the memory they need beyond a fixed amount of stack
+ * space from the context, so the memory footprint of each worker thread is known in advance. Functions
+ * without a _ctx variant don't need more than a fixed amount of stack space anyway.
+ * @{
+ */
+
+/**
+ * Returns the arena size needed by \ref ecc_25519_ctx_init
+ *
+ * flags is a combination of the ECC_25519_CTX_* flags; batch is the number of points the batch
+ * functions process at once, which must be at least 1.
+ */
+UECC_API size_t ecc_25519_ctx_size(unsigned flags, size_t batch);
+
+/**
+ * Initializes a context using the given arena
+ *
+ * The arena must stay valid as long as the context is used. Points in batches larger than
+ * the arena can hold (see \ref ecc_25519_ctx_size) are processed in several steps.
+ *
+ * With \ref ECC_25519_CTX_BASE_TABLE, a table for the default base point is computed (see
+ * \ref ecc_25519_fixed_base_init).
+ *
+ * Returns 0 if the arena is too small to hold the tables and scratch space for a single point, 1 otherwise.
+ */
+UECC_API int ecc_25519_ctx_init(ecc_25519_ctx_t *ctx, void *arena, size_t size, unsigned flags);
+
+/**
+ * Does a scalar multiplication of the default base point with an integer, using the table of a context
+ *
+ * The result is the same as the one of \ref ecc_25519_scalarmult_base. If the context holds a table
+ * of the default base point (see \ref ECC_25519_CTX_BASE_TABLE), it is used like with \ref ecc_25519_scalarmult_fixed,
+ * which is considerably faster. The multiplication runs in constant time.
+ */
+UECC_API void ecc_25519_scalarmult_base_ctx(ecc_25519_ctx_t *ctx, ecc_25519_work_t *out, const ecc_int256_t *n);
+
+/**
+ * Converts an array of packed points from one format into another, using the scratch space of a context
+ *
+ * This works like \ref ecc_25519_transcode_packed_batch, but a single reciprocal is shared by as many
+ * points as the scratch space of the context can hold, instead of a fixed small number of points.
+ */
+UECC_API size_t ecc_25519_transcode_packed_batch_ctx(ecc_25519_ctx_t *ctx, ecc_int256_t *out, int *status, const ecc_int256_t *in,
+						     size_t count, ecc_25519_format_t from, ecc_25519_format_t to);
+
+/**@}*/
+
+/**
+ * \defgroup stats_ops Instrumentation
+ * @{
+ */
+
+/**
+ * Returns the number of internal prime field operations done by the calling thread
+ *
+ * The counters are only maintained when libuecc is built with the CMake option ENABLE_STATS;
+ * otherwise, all counters are always zero.
+ */
+UECC_API void ecc_25519_stats_get(ecc_25519_stats_t *out);
+
+/** Resets the operation counters of the calling thread */
+UECC_API void ecc_25519_stats_reset(void);
 
 /**@}*/
 
@@ -280,42 +983,42 @@ extern const ecc_int256_t ecc_25519_gf_order;
 
 
 /** Checks if an integer is equal to zero (after reduction) */
-int ecc_25519_gf_is_zero(const ecc_int256_t *in);
+UECC_API int ecc_25519_gf_is_zero(const ecc_int256_t *in);
 
 /**
  * Adds two integers as Galois field elements
  *
  * The same pointers may be given for input and output.
  */
-void ecc_25519_gf_add(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2);
+UECC_API void ecc_25519_gf_add(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2);
 
 /**
  * Subtracts two integers as Galois field elements
  *
  * The same pointers may be given for input and output.
  */
-void ecc_25519_gf_sub(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2);
+UECC_API void ecc_25519_gf_sub(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2);
 
 /**
  * Reduces an integer to a unique representation in the range \f$ [0,q-1] \f$
  *
  * The same pointer may be given for input and output.
  */
-void ecc_25519_gf_reduce(ecc_int256_t *out, const ecc_int256_t *in);
+UECC_API void ecc_25519_gf_reduce(ecc_int256_t *out, const ecc_int256_t *in);
 
 /**
  * Multiplies two integers as Galois field elements
  *
  * The same pointers may be given for input and output.
  */
-void ecc_25519_gf_mult(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2);
+UECC_API void ecc_25519_gf_mult(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2);
 
 /**
  * Computes the reciprocal of a Galois field element
  *
  * The same pointers may be given for input and output.
  */
-void ecc_25519_gf_recip(ecc_int256_t *out, const ecc_int256_t *in);
+UECC_API void ecc_25519_gf_recip(ecc_int256_t *out, const ecc_int256_t *in);
 
 /**
  * Ensures some properties of a Galois field element to make it fit for use as a secret key
@@ -326,7 +1029,86 @@ void ecc_25519_gf_recip(ecc_int256_t *out, const ecc_int256_t *in);
  *
  * The same pointer may be given for input and output.
  */
-void ecc_25519_gf_sanitize_secret(ecc_int256_t *out, const ecc_int256_t *in);
+UECC_API void ecc_25519_gf_sanitize_secret(ecc_int256_t *out, const ecc_int256_t *in);
+
+/**
+ * Converts an integer into the Montgomery representation
+ *
+ * The integer is reduced modulo the group order. The conversion costs about half as much as \ref ecc_25519_gf_mult;
+ * each of the following operations on the Montgomery representation saves the same amount compared to the
+ * functions for \ref ecc_int256_t.
+ */
+UECC_API void ecc_25519_gf_mont_to(ecc_25519_gf_mont_t *out, const ecc_int256_t *in);
+
+/** Converts a Galois field element from the Montgomery representation into a unique integer in the range \f$ [0,q-1] \f$ */
+UECC_API void ecc_25519_gf_mont_from(ecc_int256_t *out, const ecc_25519_gf_mont_t *in);
+
+/**
+ * Adds two Galois field elements in Montgomery representation
+ *
+ * The same pointers may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_mont_add(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in1, const ecc_25519_gf_mont_t *in2);
+
+/**
+ * Subtracts two Galois field elements in Montgomery representation
+ *
+ * The same pointers may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_mont_sub(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in1, const ecc_25519_gf_mont_t *in2);
+
+/**
+ * Multiplies two Galois field elements in Montgomery representation
+ *
+ * The same pointers may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_mont_mult(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in1, const ecc_25519_gf_mont_t *in2);
+
+/**
+ * Squares a Galois field element in Montgomery representation
+ *
+ * The same pointer may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_mont_square(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in);
+
+/**
+ * Raises a Galois field element in Montgomery representation to the power of an integer
+ *
+ * This runs in constant time, with respect to both the base and the exponent.
+ *
+ * The same pointer may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_mont_pow(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in, const ecc_int256_t *exp);
+
+/**
+ * Adds count pairs of integers as Galois field elements
+ *
+ * The results are identical to calling \ref ecc_25519_gf_add for each pair. On x86 CPUs supporting AVX2,
+ * 8 pairs are processed at once.
+ *
+ * The same arrays may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_add_batch(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2, size_t count);
+
+/**
+ * Reduces count integers to unique representations in the range \f$ [0,q-1] \f$
+ *
+ * The results are identical to calling \ref ecc_25519_gf_reduce for each integer. On x86 CPUs supporting AVX2,
+ * 8 integers are processed at once.
+ *
+ * The same array may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_reduce_batch(ecc_int256_t *out, const ecc_int256_t *in, size_t count);
+
+/**
+ * Multiplies count pairs of integers as Galois field elements
+ *
+ * The results are identical to calling \ref ecc_25519_gf_mult for each pair. On x86 CPUs supporting AVX2,
+ * 8 pairs are processed at once.
+ *
+ * The same arrays may be given for input and output.
+ */
+UECC_API void ecc_25519_gf_mult_batch(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2, size_t count);
 
 /**@}*/
 
@@ -54,10 +54,16 @@
  * Invariant that must be held by all public API: the components of an
  * \ref ecc_25519_work_t are always in the range \f$ [0, 2p) \f$.
  * Integers in this range will be called \em squeezed in the following.
+ * As all squeezed integers have only the lower byte of each integer part set,
+ * they can be stored in 32 bytes; this is used for the \ref ecc_25519_work_compact_t
+ * representation.
  */
 
 #include <libuecc/ecc.h>
 
+#include "ec25519_stats.h"
+#include "ec25519_modinv.h"
+
 
 const ecc_25519_work_t ecc_25519_work_identity = {{0}, {1}, {1}, {0}};
 
@@ -114,13 +120,6 @@ const ecc_25519_work_t ecc_25519_work_base_ed25519 = {
 static const uint32_t zero[32] = {0};
 static const uint32_t one[32] = {1};
 
-static const uint32_t minus1[32] = {
-	0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f,
-};
-
 /** Ed25519 parameter -(121665/121666) */
 static const uint32_t d[32] = {
 	0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75,
@@ -130,6 +129,15 @@ static const uint32_t d[32] = {
 };
 
 
+/** X coordinate of a point of order 8 (the other points of order 8 have the X coordinate -x8) */
+static const uint32_t x8[32] = {
+	0x4a, 0xd1, 0x45, 0xc5, 0x46, 0x46, 0xa1, 0xde,
+	0x38, 0xe2, 0xe5, 0x13, 0x70, 0x3c, 0x19, 0x5c,
+	0xbb, 0x4a, 0xde, 0x38, 0x32, 0x99, 0x33, 0xe9,
+	0x28, 0x4a, 0x39, 0x06, 0xa0, 0xb9, 0xd5, 0x1f,
+};
+
+
 /** Factor to multiply the X coordinate with to convert from the legacy to the Ed25519 curve */
 static const uint32_t legacy_to_ed25519[32] = {
 	0xe7, 0x81, 0xba, 0x00, 0x55, 0xfb, 0x91, 0x33,
@@ -147,6 +155,48 @@ static const uint32_t ed25519_to_legacy[32] = {
 };
 
 
+/** The square root of -1 */
+static const uint32_t rho_s[32] = {
+	0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4,
+	0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
+	0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b,
+	0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b,
+};
+
+
+/** Ristretto255 constant \f$ \sqrt{ad - 1} \f$ */
+static const uint32_t sqrt_ad_minus_one[32] = {
+	0x1b, 0x2e, 0x7b, 0x49, 0xa0, 0xf6, 0x97, 0x7e,
+	0xbd, 0x54, 0x78, 0x1b, 0x0c, 0x8e, 0x9d, 0xaf,
+	0xfd, 0xd1, 0xf5, 0x31, 0xc9, 0xfc, 0x3c, 0x0f,
+	0xac, 0x48, 0x83, 0x2b, 0xbf, 0x31, 0x69, 0x37,
+};
+
+/** Ristretto255 constant \f$ 1/\sqrt{a - d} \f$ */
+static const uint32_t invsqrt_a_minus_d[32] = {
+	0xea, 0x40, 0x5d, 0x80, 0xaa, 0xfd, 0xc8, 0x99,
+	0xbe, 0x72, 0x41, 0x5a, 0x17, 0x16, 0x2f, 0x9d,
+	0x40, 0xd8, 0x01, 0xfe, 0x91, 0x7b, 0xc2, 0x16,
+	0xa2, 0xfc, 0xaf, 0xcf, 0x05, 0x89, 0x6c, 0x78,
+};
+
+/** Ristretto255 constant \f$ 1 - d^2 \f$ */
+static const uint32_t one_minus_d_sq[32] = {
+	0x76, 0xc1, 0x5f, 0x94, 0xc1, 0x09, 0x7c, 0xe2,
+	0x0f, 0x35, 0x5e, 0xcd, 0x38, 0xa1, 0x81, 0x2c,
+	0xe4, 0xdf, 0x70, 0xbe, 0xdd, 0xab, 0x94, 0x99,
+	0xd7, 0xe0, 0xb3, 0xb2, 0xa8, 0x72, 0x90, 0x02,
+};
+
+/** Ristretto255 constant \f$ (d - 1)^2 \f$ */
+static const uint32_t d_minus_one_sq[32] = {
+	0x20, 0x4d, 0xed, 0x44, 0xaa, 0x5a, 0xad, 0x31,
+	0x99, 0x19, 0x1e, 0xb0, 0x2c, 0x4a, 0x9e, 0xd2,
+	0xeb, 0x4e, 0x9b, 0x52, 0x2f, 0xd3, 0xdc, 0x4c,
+	0x41, 0x22, 0x6c, 0xf6, 0x7a, 0xb3, 0x68, 0x59,
+};
+
+
 /** Adds two unpacked integers (modulo p) */
 static void add(uint32_t out[32], const uint32_t a[32], const uint32_t b[32]) {
 	unsigned int j;
@@ -194,6 +244,8 @@ static void squeeze(uint32_t a[32]) {
 	unsigned int j;
 	uint32_t u;
 
+	STATS_INC(squeeze);
+
 	u = 0;
 
 	for (j = 0;j < 31;++j) {
@@ -264,6 +316,8 @@ static void mult(uint32_t out[32], const uint32_t a[32], const uint32_t b[32]) {
 	unsigned int i, j;
 	uint32_t u;
 
+	STATS_INC(mult);
+
 	for (i = 0; i < 32; ++i) {
 		u = 0;
 
@@ -288,6 +342,8 @@ static void mult_int(uint32_t out[32], uint32_t n, const uint32_t a[32]) {
 	unsigned int j;
 	uint32_t u;
 
+	STATS_INC(mult_int);
+
 	u = 0;
 
 	for (j = 0; j < 31; j++) {
@@ -318,6 +374,8 @@ static void square(uint32_t out[32], const uint32_t a[32]) {
 	unsigned int i, j;
 	uint32_t u;
 
+	STATS_INC(square);
+
 	for (i = 0; i < 32; i++) {
 		u = 0;
 
@@ -392,7 +450,7 @@ static void selectw(ecc_25519_work_t *out, const ecc_25519_work_t *r, const ecc_
 }
 
 /** Copies r to out when b == 0, s when b == 1 */
-static void select(uint32_t out[32], const uint32_t r[32], const uint32_t s[32], uint32_t b) {
+static void select_int(uint32_t out[32], const uint32_t r[32], const uint32_t s[32], uint32_t b) {
 	unsigned int j;
 	uint32_t t;
 	uint32_t bminus1;
@@ -405,163 +463,194 @@ static void select(uint32_t out[32], const uint32_t r[32], const uint32_t s[32],
 }
 
 /**
- * Computes the square root of an unpacked integer (in the prime field modulo p)
+ * Computes the "absolute value" of an unpacked integer, i.e. negates it if its fully reduced value is odd
  *
- * If the given integer has no square root, 0 is returned, 1 otherwise.
+ * The input must be \em squeezed. The same pointer may be given for input and output.
  */
-static int square_root(uint32_t out[32], const uint32_t z[32]) {
-	static const uint32_t rho_s[32] = {
-		0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4,
-		0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
-		0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b,
-		0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b
-	};
+static void absolute(uint32_t out[32], const uint32_t a[32]) {
+	uint32_t neg[32];
 
-	/* raise z to power (2^252-2), check if power (2^253-5) equals -1 */
+	/* No squeeze is necessary after subtractions from zero if the subtrahend is squeezed */
+	sub(neg, zero, a);
+	select_int(out, a, neg, parity(a));
+}
 
-	uint32_t z2[32];
-	uint32_t z9[32];
-	uint32_t z11[32];
-	uint32_t z2_5_0[32];
-	uint32_t z2_10_0[32];
-	uint32_t z2_20_0[32];
-	uint32_t z2_50_0[32];
-	uint32_t z2_100_0[32];
+/**
+ * Raises an unpacked integer to the power \f$ 2^{250} - 1 \f$ (in the prime field modulo p)
+ *
+ * This is the common part of the addition chains for \ref recip and \ref square_root_ratio.
+ * As \ref recip needs it to finish its chain, the power 11 is returned in z11.
+ */
+static void pow_2_250_1(uint32_t out[32], uint32_t z11[32], const uint32_t z[32]) {
+	/*
+	 * Only two intermediate powers are live at any time, so they share the buffers a and b:
+	 * a holds z^2, z^(2^5-1), z^(2^20-1) and z^(2^50-1), b holds z^9, z^(2^10-1) and z^(2^100-1)
+	 */
+	uint32_t a[32];
+	uint32_t b[32];
 	uint32_t t0[32];
 	uint32_t t1[32];
-	uint32_t z2_252_1[32];
-	uint32_t z2_252_1_rho_s[32];
 	int i;
 
-	/* 2 */ square(z2, z);
-	/* 4 */ square(t1, z2);
+	/* 2 */ square(a, z);
+	/* 4 */ square(t1, a);
 	/* 8 */ square(t0, t1);
-	/* 9 */ mult(z9, t0, z);
-	/* 11 */ mult(z11, z9, z2);
+	/* 9 */ mult(b, t0, z);
+	/* 11 */ mult(z11, b, a);
 	/* 22 */ square(t0, z11);
-	/* 2^5 - 2^0 = 31 */ mult(z2_5_0, t0, z9);
+	/* 2^5 - 2^0 = 31 */ mult(a, t0, b);
 
-	/* 2^6 - 2^1 */ square(t0, z2_5_0);
+	/* 2^6 - 2^1 */ square(t0, a);
 	/* 2^7 - 2^2 */ square(t1, t0);
 	/* 2^8 - 2^3 */ square(t0, t1);
 	/* 2^9 - 2^4 */ square(t1, t0);
 	/* 2^10 - 2^5 */ square(t0, t1);
-	/* 2^10 - 2^0 */ mult(z2_10_0, t0, z2_5_0);
+	/* 2^10 - 2^0 */ mult(b, t0, a);
 
-	/* 2^11 - 2^1 */ square(t0, z2_10_0);
+	/* 2^11 - 2^1 */ square(t0, b);
 	/* 2^12 - 2^2 */ square(t1, t0);
 	/* 2^20 - 2^10 */ for (i = 2; i < 10; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^20 - 2^0 */ mult(z2_20_0, t1, z2_10_0);
+	/* 2^20 - 2^0 */ mult(a, t1, b);
 
-	/* 2^21 - 2^1 */ square(t0, z2_20_0);
+	/* 2^21 - 2^1 */ square(t0, a);
 	/* 2^22 - 2^2 */ square(t1, t0);
 	/* 2^40 - 2^20 */ for (i = 2; i < 20; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^40 - 2^0 */ mult(t0, t1, z2_20_0);
+	/* 2^40 - 2^0 */ mult(t0, t1, a);
 
 	/* 2^41 - 2^1 */ square(t1, t0);
 	/* 2^42 - 2^2 */ square(t0, t1);
 	/* 2^50 - 2^10 */ for (i = 2; i < 10; i += 2) { square(t1, t0); square(t0, t1); }
-	/* 2^50 - 2^0 */ mult(z2_50_0, t0, z2_10_0);
+	/* 2^50 - 2^0 */ mult(a, t0, b);
 
-	/* 2^51 - 2^1 */ square(t0, z2_50_0);
+	/* 2^51 - 2^1 */ square(t0, a);
 	/* 2^52 - 2^2 */ square(t1, t0);
 	/* 2^100 - 2^50 */ for (i = 2; i < 50; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^100 - 2^0 */ mult(z2_100_0, t1, z2_50_0);
+	/* 2^100 - 2^0 */ mult(b, t1, a);
 
-	/* 2^101 - 2^1 */ square(t1, z2_100_0);
+	/* 2^101 - 2^1 */ square(t1, b);
 	/* 2^102 - 2^2 */ square(t0, t1);
 	/* 2^200 - 2^100 */ for (i = 2; i < 100; i += 2) { square(t1, t0); square(t0, t1); }
-	/* 2^200 - 2^0 */ mult(t1, t0, z2_100_0);
+	/* 2^200 - 2^0 */ mult(t1, t0, b);
 
 	/* 2^201 - 2^1 */ square(t0, t1);
 	/* 2^202 - 2^2 */ square(t1, t0);
 	/* 2^250 - 2^50 */ for (i = 2; i < 50; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^250 - 2^0 */ mult(t0, t1, z2_50_0);
+	/* 2^250 - 2^0 */ mult(out, t1, a);
+}
 
+/**
+ * Computes the square root of the quotient of two unpacked integers (in the prime field modulo p)
+ *
+ * The root is computed as \f$ uv^3(uv^7)^{(p-5)/8} \f$ (possibly multiplied with \f$ \sqrt{-1} \f$),
+ * which needs only a single exponentiation instead of one for the reciprocal of v and one for the
+ * square root.
+ *
+ * u must be \em squeezed. If u/v has no square root (or v is zero, but u is not), 0 is returned and
+ * out is set to a square root of \f$ \sqrt{-1} \cdot u/v \f$ instead (as required by Ristretto255); 1 is returned otherwise.
+ */
+static int square_root_ratio(uint32_t out[32], const uint32_t u[32], const uint32_t v[32]) {
+	/* t0 and t1 are scratch space; the buffers of uv3 and uv7 are reused for later values */
+	uint32_t uv3[32], uv7[32], t0[32], t1[32];
+	int correct, flipped, flipped_i;
+
+	STATS_INC(square_root);
+
+	/* v^2 */ square(t0, v);
+	/* v^3 */ mult(t1, t0, v);
+	mult(uv3, u, t1);
+	/* v^6 */ square(t0, t1);
+	/* v^7 */ mult(t1, t0, v);
+	mult(uv7, u, t1);
+
+	/* raise uv^7 to power (p-5)/8 = 2^252-3 */
+	pow_2_250_1(t0, t1, uv7);
 	/* 2^251 - 2^1 */ square(t1, t0);
 	/* 2^252 - 2^2 */ square(t0, t1);
-	/* 2^252 - 2^1 */ mult(z2_252_1, t0, z2);
+	/* 2^252 - 3 */ mult(t1, t0, uv7);
 
-	/* 2^253 - 2^3 */ square(t1, t0);
-	/* 2^253 - 6 */ mult(t0, t1, z2);
-	/* 2^253 - 5 */ mult(t1, t0, z);
+	/* r */ mult(t0, uv3, t1);
+
+	/* Check the root; if vr^2 = -u or vr^2 = -u*sqrt(-1), r must be multiplied with sqrt(-1) */
+	square(t1, t0);
+	/* vr^2 */ mult(uv7, v, t1);
+
+	sub(t1, uv7, u);
+	squeeze(t1);
+	correct = check_zero(t1);
+
+	add(t1, uv7, u);
+	squeeze(t1);
+	flipped = check_zero(t1);
 
-	mult(z2_252_1_rho_s, z2_252_1, rho_s);
+	mult(t1, u, rho_s);
+	add(t1, uv7, t1);
+	squeeze(t1);
+	flipped_i = check_zero(t1);
 
-	select(out, z2_252_1, z2_252_1_rho_s, check_equal(t1, minus1));
+	mult(uv3, t0, rho_s);
+	select_int(out, t0, uv3, flipped | flipped_i);
 
-	/* Check the root */
-	square(t0, out);
-	return check_equal(t0, z);
+	return (correct | flipped);
 }
 
 /** Computes the reciprocal of an unpacked integer (in the prime field modulo p) */
+#ifdef UECC_FERMAT_INVERSION
+
 static void recip(uint32_t out[32], const uint32_t z[32]) {
-	uint32_t z2[32];
-	uint32_t z9[32];
 	uint32_t z11[32];
-	uint32_t z2_5_0[32];
-	uint32_t z2_10_0[32];
-	uint32_t z2_20_0[32];
-	uint32_t z2_50_0[32];
-	uint32_t z2_100_0[32];
 	uint32_t t0[32];
 	uint32_t t1[32];
-	int i;
 
-	/* 2 */ square(z2, z);
-	/* 4 */ square(t1, z2);
-	/* 8 */ square(t0, t1);
-	/* 9 */ mult(z9, t0, z);
-	/* 11 */ mult(z11, z9, z2);
-	/* 22 */ square(t0, z11);
-	/* 2^5 - 2^0 = 31 */ mult(z2_5_0, t0, z9);
+	STATS_INC(recip);
 
-	/* 2^6 - 2^1 */ square(t0, z2_5_0);
-	/* 2^7 - 2^2 */ square(t1, t0);
-	/* 2^8 - 2^3 */ square(t0, t1);
-	/* 2^9 - 2^4 */ square(t1, t0);
-	/* 2^10 - 2^5 */ square(t0, t1);
-	/* 2^10 - 2^0 */ mult(z2_10_0, t0, z2_5_0);
+	pow_2_250_1(t0, z11, z);
+	/* 2^251 - 2^1 */ square(t1, t0);
+	/* 2^252 - 2^2 */ square(t0, t1);
+	/* 2^253 - 2^3 */ square(t1, t0);
+	/* 2^254 - 2^4 */ square(t0, t1);
+	/* 2^255 - 2^5 */ square(t1, t0);
+	/* 2^255 - 21 */ mult(out, t1, z11);
+}
 
-	/* 2^11 - 2^1 */ square(t0, z2_10_0);
-	/* 2^12 - 2^2 */ square(t1, t0);
-	/* 2^20 - 2^10 */ for (i = 2; i < 10; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^20 - 2^0 */ mult(z2_20_0, t1, z2_10_0);
+#else
 
-	/* 2^21 - 2^1 */ square(t0, z2_20_0);
-	/* 2^22 - 2^2 */ square(t1, t0);
-	/* 2^40 - 2^20 */ for (i = 2; i < 20; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^40 - 2^0 */ mult(t0, t1, z2_20_0);
+/** The prime \f$ p = 2^{255} - 19 \f$ for \ref modinv */
+static const modinv_modinfo_t modinfo_p = {
+	{{
+		0x3fffffed, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff,
+		0x3fffffff, 0x3fffffff, 0x3fffffff, 0x7fff
+	}},
+	0x179435e5 /* p^-1 mod 2^30 */
+};
 
-	/* 2^41 - 2^1 */ square(t1, t0);
-	/* 2^42 - 2^2 */ square(t0, t1);
-	/* 2^50 - 2^10 */ for (i = 2; i < 10; i += 2) { square(t1, t0); square(t0, t1); }
-	/* 2^50 - 2^0 */ mult(z2_50_0, t0, z2_10_0);
+static void recip(uint32_t out[32], const uint32_t z[32]) {
+	modinv_signed30_t x;
+	uint32_t t[32];
+	uint8_t b[32];
+	int i;
 
-	/* 2^51 - 2^1 */ square(t0, z2_50_0);
-	/* 2^52 - 2^2 */ square(t1, t0);
-	/* 2^100 - 2^50 */ for (i = 2; i < 50; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^100 - 2^0 */ mult(z2_100_0, t1, z2_50_0);
+	STATS_INC(recip);
 
-	/* 2^101 - 2^1 */ square(t1, z2_100_0);
-	/* 2^102 - 2^2 */ square(t0, t1);
-	/* 2^200 - 2^100 */ for (i = 2; i < 100; i += 2) { square(t1, t0); square(t0, t1); }
-	/* 2^200 - 2^0 */ mult(t1, t0, z2_100_0);
+	/* Like the multiplications, recip accepts unsqueezed inputs (e.g. the results of sub) */
+	for (i = 0; i < 32; i++)
+		t[i] = z[i];
 
-	/* 2^201 - 2^1 */ square(t0, t1);
-	/* 2^202 - 2^2 */ square(t1, t0);
-	/* 2^250 - 2^50 */ for (i = 2; i < 50; i += 2) { square(t0, t1); square(t1, t0); }
-	/* 2^250 - 2^0 */ mult(t0, t1, z2_50_0);
+	squeeze(t);
+	freeze(t);
 
-	/* 2^251 - 2^1 */ square(t1, t0);
-	/* 2^252 - 2^2 */ square(t0, t1);
-	/* 2^253 - 2^3 */ square(t1, t0);
-	/* 2^254 - 2^4 */ square(t0, t1);
-	/* 2^255 - 2^5 */ square(t1, t0);
-	/* 2^255 - 21 */ mult(out, t1, z11);
+	for (i = 0; i < 32; i++)
+		b[i] = t[i];
+
+	modinv_from_bytes(&x, b);
+	modinv(&x, &modinfo_p);
+	modinv_to_bytes(b, &x);
+
+	for (i = 0; i < 32; i++)
+		out[i] = b[i];
 }
 
+#endif
+
 /**
  * Checks if the X and Y coordinates of a work structure represent a valid point of the curve
  *
@@ -673,8 +762,10 @@ void ecc_25519_store_xy(ecc_int256_t *x, ecc_int256_t *y, const ecc_25519_work_t
 
 int ecc_25519_load_packed_ed25519(ecc_25519_work_t *out, const ecc_int256_t *in) {
 	int i;
-	uint32_t Y2[32] /* Y^2 */, dY2[32] /* dY^2 */, Y2_1[32] /* Y^2-1 */, dY2_1[32] /* dY^2+1 */, _1_dY2_1[32] /* 1/(dY^2+1) */;
-	uint32_t X2[32] /* X^2 */, X[32], Xt[32];
+	uint32_t Y2[32] /* Y^2 */, dY2[32] /* dY^2 */, Y2_1[32] /* Y^2-1 */, dY2_1[32] /* dY^2+1 */;
+	uint32_t X[32], Xt[32];
+
+	PROBE(load__entry);
 
 	for (i = 0; i < 32; i++) {
 		out->Y[i] = in->p[i];
@@ -686,27 +777,31 @@ int ecc_25519_load_packed_ed25519(ecc_25519_work_t *out, const ecc_int256_t *in)
 	square(Y2, out->Y);
 	mult(dY2, d, Y2);
 	sub(Y2_1, Y2, one);
+	squeeze(Y2_1);
 	add(dY2_1, dY2, one);
-	recip(_1_dY2_1, dY2_1);
-	mult(X2, Y2_1, _1_dY2_1);
 
-	if (!square_root(X, X2))
+	if (!square_root_ratio(X, Y2_1, dY2_1)) {
+		PROBE(load__return);
 		return 0;
+	}
 
 	/* No squeeze is necessary after subtractions from zero if the subtrahend is squeezed */
 	sub(Xt, zero, X);
 
-	select(out->X, X, Xt, (in->p[31] >> 7) ^ parity(X));
+	select_int(out->X, X, Xt, (in->p[31] >> 7) ^ parity(X));
 
 	mult(out->T, out->X, out->Y);
 
+	PROBE(load__return);
 	return 1;
 }
 
 int ecc_25519_load_packed_legacy(ecc_25519_work_t *out, const ecc_int256_t *in) {
 	int i;
-	uint32_t X2[32] /* X^2 */, aX2[32] /* aX^2 */, dX2[32] /* dX^2 */, _1_aX2[32] /* 1-aX^2 */, _1_dX2[32] /* 1-aX^2 */;
-	uint32_t _1_1_dX2[32]  /* 1/(1-aX^2) */, Y2[32] /* Y^2 */, Y[32], Yt[32], X_legacy[32];
+	uint32_t X2[32] /* X^2 */, aX2[32] /* aX^2 */, dX2[32] /* dX^2 */, _1_aX2[32] /* 1-aX^2 */, _1_dX2[32] /* 1-dX^2 */;
+	uint32_t Y[32], Yt[32], X_legacy[32];
+
+	PROBE(load__entry);
 
 	for (i = 0; i < 32; i++) {
 		X_legacy[i] = in->p[i];
@@ -719,21 +814,23 @@ int ecc_25519_load_packed_legacy(ecc_25519_work_t *out, const ecc_int256_t *in)
 	mult_int(aX2, UINT32_C(486664), X2);
 	mult_int(dX2, UINT32_C(486660), X2);
 	sub(_1_aX2, one, aX2);
+	squeeze(_1_aX2);
 	sub(_1_dX2, one, dX2);
-	recip(_1_1_dX2, _1_dX2);
-	mult(Y2, _1_aX2, _1_1_dX2);
 
-	if (!square_root(Y, Y2))
+	if (!square_root_ratio(Y, _1_aX2, _1_dX2)) {
+		PROBE(load__return);
 		return 0;
+	}
 
 	/* No squeeze is necessary after subtractions from zero if the subtrahend is squeezed */
 	sub(Yt, zero, Y);
 
-	select(out->Y, Y, Yt, (in->p[31] >> 7) ^ parity(Y));
+	select_int(out->Y, Y, Yt, (in->p[31] >> 7) ^ parity(Y));
 
 	mult(out->X, X_legacy, legacy_to_ed25519);
 	mult(out->T, out->X, out->Y);
 
+	PROBE(load__return);
 	return 1;
 }
 
@@ -745,186 +842,2327 @@ int ecc_25519_load_packed(ecc_25519_work_t *out, const ecc_int256_t *in) {
 void ecc_25519_store_packed_ed25519(ecc_int256_t *out, const ecc_25519_work_t *in) {
 	ecc_int256_t x;
 
+	PROBE(store__entry);
+
 	ecc_25519_store_xy_ed25519(&x, out, in);
 	out->p[31] |= (x.p[0] << 7);
+
+	PROBE(store__return);
 }
 
 void ecc_25519_store_packed_legacy(ecc_int256_t *out, const ecc_25519_work_t *in) {
 	ecc_int256_t y;
 
+	PROBE(store__entry);
+
 	ecc_25519_store_xy_legacy(out, &y, in);
 	out->p[31] |= (y.p[0] << 7);
+
+	PROBE(store__return);
 }
 
 void ecc_25519_store_packed(ecc_int256_t *out, const ecc_25519_work_t *in) {
 	ecc_25519_store_packed_legacy(out, in);
 }
 
+/**
+ * Computes the denominator of a point in the packed representation of the given format for \ref store_packed_batch
+ *
+ * The denominator is Z for the Ed25519 and the legacy format and Z-Y for the Montgomery format. The latter is
+ * zero for the identity, so it is replaced by 1 then (and the identity is stored as u = 0 like in
+ * \ref ecc_25519_store_packed_montgomery); 1 is returned in this case.
+ */
+static int store_packed_den(uint32_t den[32], const ecc_25519_work_t *in, ecc_25519_format_t format) {
+	int j, den_zero;
 
-int ecc_25519_is_identity(const ecc_25519_work_t *in) {
-	uint32_t Y_Z[32];
+	if (format != ECC_25519_FORMAT_MONTGOMERY) {
+		for (j = 0; j < 32; j++)
+			den[j] = in->Z[j];
+		squeeze(den);
+		return 0;
+	}
 
-	sub(Y_Z, in->Y, in->Z);
-	squeeze(Y_Z);
+	sub(den, in->Z, in->Y);
+	squeeze(den);
 
-	return (check_zero(in->X)&check_zero(Y_Z));
+	den_zero = check_zero(den);
+	select_int(den, den, one, den_zero);
+	return den_zero;
 }
 
-void ecc_25519_negate(ecc_25519_work_t *out, const ecc_25519_work_t *in) {
-	int i;
+/** Stores an array of points into their packed representations in the Ed25519, the legacy or the Montgomery format */
+static void store_packed_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count, ecc_25519_format_t format) {
+	uint32_t acc[32], inv[32], den[32], X[32], Y[32];
+	size_t i;
+	int j, den_zero;
 
-	for (i = 0; i < 32; i++) {
-		out->Y[i] = in->Y[i];
-		out->Z[i] = in->Z[i];
+	if (!count)
+		return;
+
+	/*
+	 * Montgomery's trick: the products of the denominators 0 ... i are kept in out[i] (the results of mult
+	 * are squeezed, so they fit into 32 bytes), so a single reciprocal is needed for the whole batch
+	 */
+	store_packed_den(acc, &in[0], format);
+
+	for (i = 0; ; i++) {
+		for (j = 0; j < 32; j++)
+			out[i].p[j] = acc[j];
+
+		if (i == count-1)
+			break;
+
+		store_packed_den(den, &in[i+1], format);
+		mult(X, acc, den);
+		for (j = 0; j < 32; j++)
+			acc[j] = X[j];
 	}
 
-	/* No squeeze is necessary after subtractions from zero if the subtrahend is squeezed */
-	sub(out->X, zero, in->X);
-	sub(out->T, zero, in->T);
+	recip(inv, acc);
+	for (j = 0; j < 32; j++)
+		acc[j] = inv[j];
+
+	for (i = count; i-- > 0;) {
+		/* acc is the reciprocal of the product of the denominators 0 ... i */
+		den_zero = store_packed_den(den, &in[i], format);
+
+		if (i > 0) {
+			for (j = 0; j < 32; j++)
+				Y[j] = out[i-1].p[j];
+
+			mult(inv, acc, Y);
+			mult(Y, acc, den);
+			for (j = 0; j < 32; j++)
+				acc[j] = Y[j];
+		}
+		else {
+			for (j = 0; j < 32; j++)
+				inv[j] = acc[j];
+		}
+
+		switch (format) {
+		case ECC_25519_FORMAT_MONTGOMERY:
+			/* u = (Z+Y)/(Z-Y) */
+			add(Y, in[i].Z, in[i].Y);
+			mult(X, Y, inv);
+			select_int(X, X, zero, den_zero);
+			freeze(X);
+
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = X[j];
+			break;
+
+		case ECC_25519_FORMAT_LEGACY:
+			mult(Y, inv, in[i].X);
+			mult(X, Y, ed25519_to_legacy);
+			mult(Y, inv, in[i].Y);
+			freeze(X);
+			freeze(Y);
+
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = X[j];
+			out[i].p[31] |= (Y[0] << 7);
+			break;
+
+		default:
+			mult(X, inv, in[i].X);
+			mult(Y, inv, in[i].Y);
+			freeze(X);
+			freeze(Y);
+
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = Y[j];
+			out[i].p[31] |= (X[0] << 7);
+		}
+	}
 }
 
-void ecc_25519_double(ecc_25519_work_t *out, const ecc_25519_work_t *in) {
-	uint32_t A[32], B[32], C[32], D[32], E[32], F[32], G[32], H[32], t0[32], t1[32];
+void ecc_25519_store_packed_ed25519_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count) {
+	store_packed_batch(out, in, count, ECC_25519_FORMAT_ED25519);
+}
 
-	square(A, in->X);
+void ecc_25519_store_packed_legacy_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count) {
+	store_packed_batch(out, in, count, ECC_25519_FORMAT_LEGACY);
+}
 
-	square(B, in->Y);
+void ecc_25519_store_packed_montgomery_batch(ecc_int256_t *out, const ecc_25519_work_t *in, size_t count) {
+	store_packed_batch(out, in, count, ECC_25519_FORMAT_MONTGOMERY);
+}
 
-	square(t0, in->Z);
-	mult_int(C, 2, t0);
+int ecc_25519_load_packed_montgomery(ecc_25519_work_t *out, const ecc_int256_t *in) {
+	uint32_t u[32], num[32], den[32], X[32], Xt[32], t0[32];
+	int i, ok;
 
-	sub(D, zero, A);
+	PROBE(load__entry);
 
-	add(t0, in->X, in->Y);
-	square(t1, t0);
-	sub(t0, t1, A);
-	sub(E, t0, B);
+	for (i = 0; i < 32; i++)
+		u[i] = in->p[i];
 
-	add(G, D, B);
-	sub(F, G, C);
-	sub(H, D, B);
+	u[31] &= 0x7f;
 
-	mult(out->X, E, F);
-	mult(out->Y, G, H);
-	mult(out->T, E, H);
-	mult(out->Z, F, G);
-}
+	/* y = (u-1)/(u+1) is kept as Y/Z */
+	sub(out->Y, u, one);
+	squeeze(out->Y);
+	add(out->Z, u, one);
+	squeeze(out->Z);
 
-void ecc_25519_add(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
-	const uint32_t j = UINT32_C(60833);
-	const uint32_t k = UINT32_C(121665);
-	uint32_t A[32], B[32], C[32], D[32], E[32], F[32], G[32], H[32], t0[32], t1[32];
+	/* x^2 = (y^2-1)/(dy^2+1) = -4u/(d(u-1)^2 + (u+1)^2) */
+	mult_int(t0, 4, u);
+	sub(num, zero, t0);
+	square(t0, out->Y);
+	mult(den, d, t0);
+	square(t0, out->Z);
+	add(den, den, t0);
 
-	sub(t0, in1->Y, in1->X);
-	mult_int(t1, j, t0);
-	sub(t0, in2->Y, in2->X);
-	mult(A, t0, t1);
+	ok = square_root_ratio(X, num, den);
 
-	add(t0, in1->Y, in1->X);
-	mult_int(t1, j, t0);
-	add(t0, in2->Y, in2->X);
-	mult(B, t0, t1);
+	/* The u coordinate doesn't contain the sign of x; the even root is used */
+	sub(Xt, zero, X);
+	select_int(X, X, Xt, parity(X));
 
-	mult_int(t0, k, in2->T);
-	mult(C, in1->T, t0);
+	mult(out->X, X, out->Z);
+	mult(out->T, X, out->Y);
 
-	mult_int(t0, 2*j, in2->Z);
-	mult(D, in1->Z, t0);
+	PROBE(load__return);
+	return ok;
+}
 
-	sub(E, B, A);
-	add(F, D, C);
-	sub(G, D, C);
-	add(H, B, A);
+void ecc_25519_store_packed_montgomery(ecc_int256_t *out, const ecc_25519_work_t *in) {
+	uint32_t num[32], den[32], u[32];
+	int i;
 
-	mult(out->X, E, F);
-	mult(out->Y, G, H);
-	mult(out->T, E, H);
-	mult(out->Z, F, G);
+	PROBE(store__entry);
+
+	/* u = (1+y)/(1-y) = (Z+Y)/(Z-Y) */
+	add(num, in->Z, in->Y);
+	sub(u, in->Z, in->Y);
+	recip(den, u);
+	mult(u, num, den);
+	freeze(u);
+
+	for (i = 0; i < 32; i++)
+		out->p[i] = u[i];
+
+	PROBE(store__return);
 }
 
-/** Adds two points of the Elliptic Curve, assuming that in2->Z == 1 */
-static void ecc_25519_add1(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
-	const uint32_t j = UINT32_C(60833);
-	const uint32_t k = UINT32_C(121665);
-	uint32_t A[32], B[32], C[32], D[32], E[32], F[32], G[32], H[32], t0[32], t1[32];
+int ecc_25519_load_packed_ristretto255(ecc_25519_work_t *out, const ecc_int256_t *in) {
+	uint32_t S[32], u1[32], u2[32], u2_2[32], v[32], invsqrt[32], den_x[32], t0[32], t1[32];
+	int i, ok;
 
-	sub(t0, in1->Y, in1->X);
-	mult_int(t1, j, t0);
-	sub(t0, in2->Y, in2->X);
-	mult(A, t0, t1);
+	PROBE(load__entry);
 
-	add(t0, in1->Y, in1->X);
-	mult_int(t1, j, t0);
-	add(t0, in2->Y, in2->X);
-	mult(B, t0, t1);
+	for (i = 0; i < 32; i++) {
+		S[i] = in->p[i];
+		out->Z[i] = (i == 0);
+	}
 
-	mult_int(t0, k, in2->T);
-	mult(C, in1->T, t0);
+	S[31] &= 0x7f;
 
-	mult_int(D, 2*j, in1->Z);
+	/* Only the canonical, non-negative encoding is accepted */
+	for (i = 0; i < 32; i++)
+		t0[i] = S[i];
+	freeze(t0);
+	ok = check_equal(t0, S) & ~(in->p[31] >> 7) & ~parity(S) & 1;
 
-	sub(E, B, A);
-	add(F, D, C);
-	sub(G, D, C);
-	add(H, B, A);
+	square(t0, S);
+	sub(u1, one, t0);
+	add(u2, one, t0);
+	square(u2_2, u2);
 
-	mult(out->X, E, F);
-	mult(out->Y, G, H);
-	mult(out->T, E, H);
-	mult(out->Z, F, G);
+	/* v = -(d u1^2) - u2^2 */
+	square(t0, u1);
+	mult(t1, d, t0);
+	add(t0, t1, u2_2);
+	squeeze(t0);
+	sub(v, zero, t0);
+
+	/* The only exponentiation: 1/sqrt(v u2^2) */
+	mult(t0, v, u2_2);
+	ok &= square_root_ratio(invsqrt, one, t0);
+
+	mult(den_x, invsqrt, u2);
+
+	add(t0, S, S);
+	mult(t1, t0, den_x);
+	absolute(out->X, t1);
+
+	/* den_y = invsqrt den_x v */
+	mult(t0, invsqrt, den_x);
+	mult(t1, t0, v);
+	mult(out->Y, u1, t1);
+
+	mult(out->T, out->X, out->Y);
+
+	ok &= ~parity(out->T) & ~check_zero(out->Y) & 1;
+
+	PROBE(load__return);
+	return ok;
 }
 
-void ecc_25519_sub(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
-	ecc_25519_work_t in2_neg;
+void ecc_25519_store_packed_ristretto255(ecc_int256_t *out, const ecc_25519_work_t *in) {
+	uint32_t u1[32], u2[32], den1[32], den2[32], z_inv[32], X[32], Y[32], t0[32], t1[32];
+	int i, rotate;
 
-	ecc_25519_negate(&in2_neg, in2);
-	ecc_25519_add(out, in1, &in2_neg);
+	PROBE(store__entry);
+
+	add(t0, in->Z, in->Y);
+	sub(t1, in->Z, in->Y);
+	mult(u1, t0, t1);
+	mult(u2, in->X, in->Y);
+
+	/* 1/sqrt(u1 u2^2) */
+	square(t0, u2);
+	mult(t1, u1, t0);
+	square_root_ratio(t0, one, t1);
+
+	mult(den1, t0, u1);
+	mult(den2, t0, u2);
+	mult(t0, den1, den2);
+	mult(z_inv, t0, in->T);
+
+	/* Rotate the point by the 4-torsion point (i, 0) if T/Z is negative */
+	mult(t0, in->T, z_inv);
+	rotate = parity(t0);
+
+	mult(t0, in->Y, rho_s);
+	select_int(X, in->X, t0, rotate);
+	mult(t0, in->X, rho_s);
+	select_int(Y, in->Y, t0, rotate);
+	mult(t0, den1, invsqrt_a_minus_d);
+	select_int(den2, den2, t0, rotate);
+
+	mult(t0, X, z_inv);
+	sub(t1, zero, Y);
+	select_int(Y, Y, t1, parity(t0));
+
+	sub(t0, in->Z, Y);
+	mult(t1, den2, t0);
+	absolute(t0, t1);
+	freeze(t0);
+
+	for (i = 0; i < 32; i++)
+		out->p[i] = t0[i];
+
+	PROBE(store__return);
 }
 
-void ecc_25519_scalarmult_bits(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base, unsigned bits) {
-	ecc_25519_work_t Q2, Q2p;
-	ecc_25519_work_t cur = ecc_25519_work_identity;
-	int b, pos;
+int ecc_25519_ristretto255_equal(const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
+	uint32_t t0[32], t1[32];
+	int ret;
 
-	if (bits > 256)
-		bits = 256;
+	/* X1 Y2 = Y1 X2 or Y1 Y2 = X1 X2 */
+	mult(t0, in1->X, in2->Y);
+	mult(t1, in1->Y, in2->X);
+	sub(t0, t0, t1);
+	squeeze(t0);
+	ret = check_zero(t0);
 
-	for (pos = bits - 1; pos >= 0; --pos) {
-		b = n->p[pos / 8] >> (pos & 7);
-		b &= 1;
+	mult(t0, in1->Y, in2->Y);
+	mult(t1, in1->X, in2->X);
+	sub(t0, t0, t1);
+	squeeze(t0);
 
-		ecc_25519_double(&Q2, &cur);
-		ecc_25519_add(&Q2p, &Q2, base);
-		selectw(&cur, &Q2, &Q2p, b);
-	}
+	return ret | check_zero(t0);
+}
 
-	*out = cur;
+/** Maps 32 bytes to a point of the curve using the Ristretto255 variant of the Elligator 2 map */
+static void ristretto255_map(ecc_25519_work_t *out, const uint8_t in[32]) {
+	uint32_t T[32], r[32], u[32], v[32], S[32], N[32], w0[32], w1[32], t0[32], t1[32];
+	int i, was_square;
+
+	for (i = 0; i < 32; i++)
+		T[i] = in[i];
+
+	T[31] &= 0x7f;
+
+	square(t0, T);
+	mult(r, rho_s, t0);
+
+	/* u = (r + 1)(1 - d^2) */
+	add(t0, r, one);
+	mult(u, t0, one_minus_d_sq);
+
+	/* v = (-1 - rd)(r + d) */
+	mult(t0, r, d);
+	add(t1, t0, one);
+	squeeze(t1);
+	sub(t0, zero, t1);
+	add(t1, r, d);
+	mult(v, t0, t1);
+
+	was_square = square_root_ratio(S, u, v);
+	absolute(S, S);
+
+	/* S' = -|S T| */
+	mult(t0, S, T);
+	absolute(t0, t0);
+	sub(t1, zero, t0);
+	select_int(S, t1, S, was_square);
+
+	/* c = -1 if u/v was square, r otherwise */
+	sub(t0, zero, one);
+	select_int(t0, r, t0, was_square);
+
+	/* N = c (r - 1) (d - 1)^2 - v */
+	sub(t1, r, one);
+	mult(N, t0, t1);
+	mult(t0, N, d_minus_one_sq);
+	sub(N, t0, v);
+
+	add(t0, S, S);
+	mult(w0, t0, v);
+	mult(w1, N, sqrt_ad_minus_one);
+
+	square(t0, S);
+	/* w2 */ sub(u, one, t0);
+	/* w3 */ add(v, one, t0);
+
+	mult(out->X, w0, v);
+	mult(out->Y, u, w1);
+	mult(out->Z, w1, v);
+	mult(out->T, w0, u);
 }
 
-void ecc_25519_scalarmult(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base) {
-	ecc_25519_scalarmult_bits(out, n, base, 256);
+void ecc_25519_ristretto255_from_uniform(ecc_25519_work_t *out, const uint8_t in[64]) {
+	ecc_25519_work_t P1, P2;
+
+	ristretto255_map(&P1, in);
+	ristretto255_map(&P2, in+32);
+	ecc_25519_add(out, &P1, &P2);
 }
 
-void ecc_25519_scalarmult_base_bits(ecc_25519_work_t *out, const ecc_int256_t *n, unsigned bits) {
-	ecc_25519_work_t Q2, Q2p;
-	ecc_25519_work_t cur = ecc_25519_work_identity;
-	int b, pos;
+/** Loads a packed point in the given format into its unpacked representation */
+static int load_packed(ecc_25519_work_t *out, const ecc_int256_t *in, ecc_25519_format_t format) {
+	switch (format) {
+	case ECC_25519_FORMAT_ED25519:
+		return ecc_25519_load_packed_ed25519(out, in);
 
-	if (bits > 256)
-		bits = 256;
+	case ECC_25519_FORMAT_LEGACY:
+		return ecc_25519_load_packed_legacy(out, in);
 
-	for (pos = bits - 1; pos >= 0; --pos) {
-		b = n->p[pos / 8] >> (pos & 7);
-		b &= 1;
+	case ECC_25519_FORMAT_RISTRETTO255:
+		return ecc_25519_load_packed_ristretto255(out, in);
 
-		ecc_25519_double(&Q2, &cur);
-		ecc_25519_add1(&Q2p, &Q2, &ecc_25519_work_default_base);
-		selectw(&cur, &Q2, &Q2p, b);
+	case ECC_25519_FORMAT_MONTGOMERY:
+		return ecc_25519_load_packed_montgomery(out, in);
+
+	default:
+		return 0;
 	}
+}
 
-	*out = cur;
+/** Stores a point into its packed representation in the given format */
+static void store_packed(ecc_int256_t *out, const ecc_25519_work_t *in, ecc_25519_format_t format) {
+	switch (format) {
+	case ECC_25519_FORMAT_LEGACY:
+		ecc_25519_store_packed_legacy(out, in);
+		break;
+
+	case ECC_25519_FORMAT_RISTRETTO255:
+		ecc_25519_store_packed_ristretto255(out, in);
+		break;
+
+	case ECC_25519_FORMAT_MONTGOMERY:
+		ecc_25519_store_packed_montgomery(out, in);
+		break;
+
+	default:
+		ecc_25519_store_packed_ed25519(out, in);
+	}
 }
 
-void ecc_25519_scalarmult_base(ecc_25519_work_t *out, const ecc_int256_t *n) {
-	ecc_25519_scalarmult_base_bits(out, n, 256);
+/**
+ * Stores a point with Z == 1 into its packed representation in the Ed25519 or the legacy format
+ *
+ * Unlike \ref store_packed, this doesn't need a reciprocal.
+ */
+static void store_packed_affine(ecc_int256_t *out, const ecc_25519_work_t *in, ecc_25519_format_t format) {
+	uint32_t X[32], Y[32];
+	int i;
+
+	if (format == ECC_25519_FORMAT_LEGACY) {
+		mult(X, in->X, ed25519_to_legacy);
+	}
+	else {
+		for (i = 0; i < 32; i++)
+			X[i] = in->X[i];
+	}
+
+	for (i = 0; i < 32; i++)
+		Y[i] = in->Y[i];
+
+	freeze(X);
+	freeze(Y);
+
+	if (format == ECC_25519_FORMAT_LEGACY) {
+		for (i = 0; i < 32; i++)
+			out->p[i] = X[i];
+		out->p[31] |= (Y[0] << 7);
+	}
+	else {
+		for (i = 0; i < 32; i++)
+			out->p[i] = Y[i];
+		out->p[31] |= (X[0] << 7);
+	}
+}
+
+/** Number of elements sharing a reciprocal in \ref transcode_chunk_montgomery */
+#define TRANSCODE_CHUNK 16
+
+/** The scratch space needed per point by \ref transcode_chunk_montgomery (numerator, denominator and validity) */
+#define TRANSCODE_SCRATCH 65
+
+/**
+ * Transcodes n packed points from or to the Montgomery format
+ *
+ * The birational map between y and u needs a division, so Montgomery's trick is used to share
+ * a single reciprocal between all elements. The running products of the denominators are kept in
+ * the output array; scratch must have space for n * \ref TRANSCODE_SCRATCH bytes.
+ */
+static size_t transcode_chunk_montgomery(ecc_int256_t *out, int *status, const ecc_int256_t *in, size_t n, ecc_25519_format_t from, ecc_25519_format_t to, uint8_t *scratch) {
+	uint32_t acc[32], num[32], den[32], t0[32], t1[32];
+	ecc_25519_work_t work;
+	ecc_int256_t packed;
+	size_t i, ret = 0;
+	int j, ok, den_zero;
+
+	if (!n)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		if (from == ECC_25519_FORMAT_MONTGOMERY) {
+			/* y = (u-1)/(u+1) */
+			for (j = 0; j < 32; j++)
+				t0[j] = in[i].p[j];
+			t0[31] &= 0x7f;
+
+			sub(num, t0, one);
+			add(den, t0, one);
+			ok = 1;
+		}
+		else {
+			/* u = (1+y)/(1-y); for Ed25519 input, the Y coordinate is used without checking for a valid point */
+			if (from == ECC_25519_FORMAT_ED25519) {
+				for (j = 0; j < 32; j++)
+					work.Y[j] = in[i].p[j];
+				work.Y[31] &= 0x7f;
+				ok = 1;
+			}
+			else {
+				ok = load_packed(&work, &in[i], from);
+			}
+
+			add(num, one, work.Y);
+			sub(den, one, work.Y);
+		}
+
+		squeeze(num);
+		squeeze(den);
+
+		/*
+		 * The denominator is zero for u = -1, which isn't on the curve, and for the identity (y = 1),
+		 * which is mapped to u = 0
+		 */
+		den_zero = check_zero(den);
+		if (from == ECC_25519_FORMAT_MONTGOMERY)
+			ok &= !den_zero;
+		else
+			select_int(num, num, zero, den_zero);
+		select_int(den, den, one, den_zero);
+
+		for (j = 0; j < 32; j++) {
+			scratch[TRANSCODE_SCRATCH*i + j] = num[j];
+			scratch[TRANSCODE_SCRATCH*i + 32 + j] = den[j];
+		}
+		scratch[TRANSCODE_SCRATCH*i + 64] = ok;
+
+		if (i == 0) {
+			for (j = 0; j < 32; j++)
+				acc[j] = den[j];
+		}
+		else {
+			mult(t0, acc, den);
+			for (j = 0; j < 32; j++)
+				acc[j] = t0[j];
+		}
+
+		for (j = 0; j < 32; j++)
+			out[i].p[j] = acc[j];
+	}
+
+	recip(t0, acc);
+	for (j = 0; j < 32; j++)
+		acc[j] = t0[j];
+
+	for (i = n; i-- > 0;) {
+		/* acc is the reciprocal of the product of the first i+1 denominators */
+		if (i > 0) {
+			for (j = 0; j < 32; j++) {
+				t0[j] = out[i-1].p[j];
+				den[j] = scratch[TRANSCODE_SCRATCH*i + 32 + j];
+			}
+
+			mult(t1, acc, t0);
+			mult(t0, acc, den);
+			for (j = 0; j < 32; j++)
+				acc[j] = t0[j];
+		}
+		else {
+			for (j = 0; j < 32; j++)
+				t1[j] = acc[j];
+		}
+
+		for (j = 0; j < 32; j++)
+			num[j] = scratch[TRANSCODE_SCRATCH*i + j];
+		mult(t0, num, t1);
+		freeze(t0);
+
+		ok = scratch[TRANSCODE_SCRATCH*i + 64];
+
+		for (j = 0; j < 32; j++)
+			packed.p[j] = t0[j];
+
+		if (from == ECC_25519_FORMAT_MONTGOMERY && to != ECC_25519_FORMAT_ED25519) {
+			/* The x coordinate needs a square root; the even one is used like in ecc_25519_load_packed_montgomery */
+			ok &= ecc_25519_load_packed_ed25519(&work, &packed);
+
+			if (to == ECC_25519_FORMAT_RISTRETTO255)
+				ecc_25519_store_packed_ristretto255(&packed, &work);
+			else
+				store_packed_affine(&packed, &work, to);
+		}
+
+		for (j = 0; j < 32; j++)
+			out[i].p[j] = ok ? packed.p[j] : 0;
+
+		if (status)
+			status[i] = ok;
+
+		ret += ok;
+	}
+
+	return ret;
+}
+
+/** Transcodes packed points, sharing reciprocals between up to chunk points using the given scratch space */
+static size_t transcode_packed_batch(ecc_int256_t *out, int *status, const ecc_int256_t *in, size_t count, ecc_25519_format_t from, ecc_25519_format_t to,
+				     uint8_t *scratch, size_t chunk) {
+	ecc_25519_work_t work;
+	size_t i, n, ret = 0;
+	int j, ok;
+
+	if ((from == ECC_25519_FORMAT_MONTGOMERY) != (to == ECC_25519_FORMAT_MONTGOMERY)) {
+		for (i = 0; i < count; i += n) {
+			n = count - i;
+			if (n > chunk)
+				n = chunk;
+
+			ret += transcode_chunk_montgomery(out+i, status ? status+i : NULL, in+i, n, from, to, scratch);
+		}
+
+		return ret;
+	}
+
+	for (i = 0; i < count; i++) {
+		/* All loaded points have Z == 1, except the ones loaded from the Montgomery format */
+		ok = load_packed(&work, &in[i], from);
+
+		if (to == ECC_25519_FORMAT_ED25519 || to == ECC_25519_FORMAT_LEGACY)
+			store_packed_affine(&out[i], &work, to);
+		else
+			store_packed(&out[i], &work, to);
+
+		if (!ok) {
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = 0;
+		}
+
+		if (status)
+			status[i] = ok;
+
+		ret += ok;
+	}
+
+	return ret;
+}
+
+size_t ecc_25519_transcode_packed_batch(ecc_int256_t *out, int *status, const ecc_int256_t *in, size_t count, ecc_25519_format_t from, ecc_25519_format_t to) {
+	uint8_t scratch[TRANSCODE_CHUNK*TRANSCODE_SCRATCH];
+
+	return transcode_packed_batch(out, status, in, count, from, to, scratch, TRANSCODE_CHUNK);
+}
+
+size_t ecc_25519_ctx_size(unsigned flags, size_t batch) {
+	size_t size = batch * TRANSCODE_SCRATCH;
+
+	if (flags & ECC_25519_CTX_BASE_TABLE)
+		size += sizeof(ecc_25519_fixed_base_t);
+
+	return size;
+}
+
+int ecc_25519_ctx_init(ecc_25519_ctx_t *ctx, void *arena, size_t size, unsigned flags) {
+	uint8_t *mem = arena;
+
+	ctx->base_table = NULL;
+
+	if (flags & ECC_25519_CTX_BASE_TABLE) {
+		if (size < sizeof(ecc_25519_fixed_base_t))
+			return 0;
+
+		/* The table consists of bytes only, so it doesn't need any alignment */
+		ctx->base_table = (ecc_25519_fixed_base_t *)mem;
+		mem += sizeof(ecc_25519_fixed_base_t);
+		size -= sizeof(ecc_25519_fixed_base_t);
+	}
+
+	ctx->scratch = mem;
+	ctx->batch = size / TRANSCODE_SCRATCH;
+
+	if (!ctx->batch)
+		return 0;
+
+	if (ctx->base_table)
+		ecc_25519_fixed_base_init(ctx->base_table, &ecc_25519_work_default_base);
+
+	return 1;
+}
+
+size_t ecc_25519_transcode_packed_batch_ctx(ecc_25519_ctx_t *ctx, ecc_int256_t *out, int *status, const ecc_int256_t *in,
+					    size_t count, ecc_25519_format_t from, ecc_25519_format_t to) {
+	return transcode_packed_batch(out, status, in, count, from, to, ctx->scratch, ctx->batch);
+}
+
+
+void ecc_25519_store_compact(ecc_25519_work_compact_t *out, const ecc_25519_work_t *in) {
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		out->X[i] = in->X[i];
+		out->Y[i] = in->Y[i];
+		out->Z[i] = in->Z[i];
+		out->T[i] = in->T[i];
+	}
+}
+
+void ecc_25519_load_compact(ecc_25519_work_t *out, const ecc_25519_work_compact_t *in) {
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		out->X[i] = in->X[i];
+		out->Y[i] = in->Y[i];
+		out->Z[i] = in->Z[i];
+		out->T[i] = in->T[i];
+	}
+}
+
+
+int ecc_25519_is_identity(const ecc_25519_work_t *in) {
+	uint32_t Y_Z[32];
+
+	sub(Y_Z, in->Y, in->Z);
+	squeeze(Y_Z);
+
+	return (check_zero(in->X)&check_zero(Y_Z));
+}
+
+int ecc_25519_equal(const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
+	uint32_t t0[32], t1[32];
+	int ret;
+
+	/* X1 Z2 = X2 Z1 and Y1 Z2 = Y2 Z1 */
+	mult(t0, in1->X, in2->Z);
+	mult(t1, in2->X, in1->Z);
+	sub(t0, t0, t1);
+	squeeze(t0);
+	ret = check_zero(t0);
+
+	mult(t0, in1->Y, in2->Z);
+	mult(t1, in2->Y, in1->Z);
+	sub(t0, t0, t1);
+	squeeze(t0);
+
+	return ret & check_zero(t0);
+}
+
+int ecc_25519_is_small_order(const ecc_25519_work_t *in) {
+	uint32_t x8Z[32], t[32];
+	int ret;
+
+	/*
+	 * The points of small order are the identity (0, 1), the point of order two (0, -1),
+	 * the points of order four (sqrt(-1), 0) and (-sqrt(-1), 0) and the points of order
+	 * eight (x8, y8), (x8, -y8), (-x8, y8) and (-x8, -y8). As these are the only points of
+	 * the curve with these X or Y coordinates, it is sufficient to check if X = 0, Y = 0
+	 * or X = x8 * Z or X = -x8 * Z.
+	 */
+
+	mult(x8Z, x8, in->Z);
+
+	ret = check_zero(in->X);
+	ret |= check_zero(in->Y);
+
+	sub(t, in->X, x8Z);
+	squeeze(t);
+	ret |= check_zero(t);
+
+	add(t, in->X, x8Z);
+	squeeze(t);
+	ret |= check_zero(t);
+
+	return ret;
+}
+
+void ecc_25519_negate(ecc_25519_work_t *out, const ecc_25519_work_t *in) {
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		out->Y[i] = in->Y[i];
+		out->Z[i] = in->Z[i];
+	}
+
+	/* No squeeze is necessary after subtractions from zero if the subtrahend is squeezed */
+	sub(out->X, zero, in->X);
+	sub(out->T, zero, in->T);
+}
+
+/**
+ * Doubles a point of the Elliptic Curve, computing the T coordinate only if with_t is set
+ *
+ * Doubling doesn't use the T coordinate of its input, so it can be skipped when the result is doubled again.
+ */
+static void double_point(ecc_25519_work_t *out, const ecc_25519_work_t *in, int with_t) {
+	/* The buffers are reused as soon as their values aren't needed anymore (A -> G, D -> H, B -> C -> F) */
+	uint32_t A[32], B[32], D[32], E[32];
+	uint32_t *const C = B, *const F = B, *const G = A, *const H = D;
+
+	square(A, in->X);
+
+	square(B, in->Y);
+
+	add(D, in->X, in->Y);
+	square(E, D);
+	sub(D, E, A);
+	sub(E, D, B);
+
+	sub(D, zero, A);
+
+	add(G, D, B);
+	sub(H, D, B);
+
+	square(C, in->Z);
+	mult_int(C, 2, C);
+	sub(F, G, C);
+
+	mult(out->X, E, F);
+	mult(out->Y, G, H);
+	if (with_t)
+		mult(out->T, E, H);
+	mult(out->Z, F, G);
+}
+
+void ecc_25519_double(ecc_25519_work_t *out, const ecc_25519_work_t *in) {
+	double_point(out, in, 1);
+}
+
+void ecc_25519_add(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
+	const uint32_t j = UINT32_C(60833);
+	const uint32_t k = UINT32_C(121665);
+	/* The buffers are reused as soon as their values aren't needed anymore (A -> F, B -> G) */
+	uint32_t A[32], B[32], C[32], D[32], E[32], H[32];
+	uint32_t *const F = A, *const G = B, *const t0 = E, *const t1 = H;
+
+	sub(t0, in1->Y, in1->X);
+	mult_int(t1, j, t0);
+	sub(t0, in2->Y, in2->X);
+	mult(A, t0, t1);
+
+	add(t0, in1->Y, in1->X);
+	mult_int(t1, j, t0);
+	add(t0, in2->Y, in2->X);
+	mult(B, t0, t1);
+
+	mult_int(t0, k, in2->T);
+	mult(C, in1->T, t0);
+
+	mult_int(t0, 2*j, in2->Z);
+	mult(D, in1->Z, t0);
+
+	sub(E, B, A);
+	add(H, B, A);
+	add(F, D, C);
+	sub(G, D, C);
+
+	mult(out->X, E, F);
+	mult(out->Y, G, H);
+	mult(out->T, E, H);
+	mult(out->Z, F, G);
+}
+
+/** Adds two points of the Elliptic Curve, assuming that in2->Z == 1 */
+static void ecc_25519_add1(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
+	const uint32_t j = UINT32_C(60833);
+	const uint32_t k = UINT32_C(121665);
+	/* The buffers are reused as soon as their values aren't needed anymore (A -> F, B -> G) */
+	uint32_t A[32], B[32], C[32], D[32], E[32], H[32];
+	uint32_t *const F = A, *const G = B, *const t0 = E, *const t1 = H;
+
+	sub(t0, in1->Y, in1->X);
+	mult_int(t1, j, t0);
+	sub(t0, in2->Y, in2->X);
+	mult(A, t0, t1);
+
+	add(t0, in1->Y, in1->X);
+	mult_int(t1, j, t0);
+	add(t0, in2->Y, in2->X);
+	mult(B, t0, t1);
+
+	mult_int(t0, k, in2->T);
+	mult(C, in1->T, t0);
+
+	mult_int(D, 2*j, in1->Z);
+
+	sub(E, B, A);
+	add(H, B, A);
+	add(F, D, C);
+	sub(G, D, C);
+
+	mult(out->X, E, F);
+	mult(out->Y, G, H);
+	mult(out->T, E, H);
+	mult(out->Z, F, G);
+}
+
+void ecc_25519_sub(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const ecc_25519_work_t *in2) {
+	ecc_25519_work_t in2_neg;
+
+	ecc_25519_negate(&in2_neg, in2);
+	ecc_25519_add(out, in1, &in2_neg);
+}
+
+/** The Montgomery curve parameter \f$ A = 486662 \f$ times 2 */
+#define MONTGOMERY_2A UINT32_C(973324)
+
+/** \f$ (A+2)/4 \f$ */
+#define MONTGOMERY_A24 UINT32_C(121666)
+
+/** The v coordinate of the default base point on the Montgomery curve used by \ref ladder_begin (its u coordinate is 9) */
+static const uint32_t default_base_v[32] = {
+	0x36, 0x87, 0x83, 0xba, 0x5a, 0xdd, 0xba, 0xa0,
+	0x57, 0xf1, 0xa6, 0x70, 0x2b, 0x76, 0x1d, 0x36,
+	0x80, 0xfb, 0x62, 0x91, 0x27, 0xff, 0xd2, 0xaa,
+	0x8b, 0xd3, 0xbd, 0xb9, 0x3a, 0xd3, 0x0a, 0x66,
+};
+
+/** Swaps a and b if swap == 1, leaves them unchanged if swap == 0 */
+static void swap_int(uint32_t a[32], uint32_t b[32], uint32_t swap) {
+	unsigned int j;
+	uint32_t t;
+	uint32_t mask = -swap;
+
+	for (j = 0; j < 32; ++j) {
+		t = mask & (a[j] ^ b[j]);
+		a[j] ^= t;
+		b[j] ^= t;
+	}
+}
+
+/**
+ * Prepares a scalar multiplication with the Montgomery ladder
+ *
+ * The ladder works on the Montgomery curve \f$ -(A+2)v^2 = u^3 + Au^2 + u \f$ with \f$ A = 486662 \f$, which is mapped to
+ * the Edwards curve by \f$ x = u/v \f$ and \f$ y = (u-1)/(u+1) \f$; u and v are the affine coordinates of the
+ * base point. Only the u coordinates of \f$ nP \f$ and \f$ (n+1)P \f$ are computed in the steps of the ladder, the
+ * v coordinate of \f$ nP \f$ is recovered by \ref ladder_finish with the formula by Okeya and Sakurai.
+ */
+static void ladder_begin(ecc_25519_scalarmult_state_t *state, const ecc_int256_t *n, const uint32_t u[32], const uint32_t v[32],
+			 const ecc_25519_work_t *base, unsigned bits) {
+	int i;
+
+	if (bits > 256)
+		bits = 256;
+
+	for (i = 0; i < 32; i++) {
+		state->u[i] = u[i];
+		state->v[i] = v[i];
+
+		state->X2[i] = (i == 0);
+		state->Z2[i] = 0;
+		state->X3[i] = u[i];
+		state->Z3[i] = (i == 0);
+	}
+
+	state->n = *n;
+	state->base = *base;
+	state->bits = bits;
+	state->pos = bits;
+	state->swap = 0;
+}
+
+/** Does up to max_bits steps of the Montgomery ladder */
+static void ladder_steps(ecc_25519_scalarmult_state_t *state, unsigned max_bits) {
+	uint32_t A[32], AA[32], B[32], BB[32], C[32], D[32], E[32], DA[32], CB[32], t0[32], t1[32];
+	uint32_t *const X2 = state->X2, *const Z2 = state->Z2, *const X3 = state->X3, *const Z3 = state->Z3;
+	uint32_t b;
+	unsigned pos;
+
+	for (; max_bits > 0 && state->pos > 0; max_bits--) {
+		pos = --state->pos;
+
+		b = state->n.p[pos / 8] >> (pos & 7);
+		b &= 1;
+
+		state->swap ^= b;
+		swap_int(X2, X3, state->swap);
+		swap_int(Z2, Z3, state->swap);
+		state->swap = b;
+
+		add(A, X2, Z2);
+		square(AA, A);
+		sub(B, X2, Z2);
+		square(BB, B);
+		sub(E, AA, BB);
+
+		add(C, X3, Z3);
+		sub(D, X3, Z3);
+		mult(DA, D, A);
+		mult(CB, C, B);
+
+		add(t0, DA, CB);
+		square(X3, t0);
+		sub(t0, DA, CB);
+		square(t1, t0);
+		mult(Z3, t1, state->u);
+
+		mult(X2, AA, BB);
+		mult_int(t0, MONTGOMERY_A24, E);
+		add(t1, BB, t0);
+		mult(Z2, E, t1);
+	}
+}
+
+/**
+ * Finishes a scalar multiplication with the Montgomery ladder, returning the full point
+ *
+ * The remaining steps of the ladder are done first. The recovery doesn't work when \f$ nP \f$ or \f$ (n+1)P \f$ is
+ * the identity, or when \f$ nP \f$ has order 2; these cases are detected and handled in constant time. The ladder
+ * can't handle base points of order 1 or 2 (the identity and the point (0, -1), which are exactly the points with
+ * X == 0, making u and v zero as well), so their multiples are selected at the end: the base point itself for odd
+ * n and the identity otherwise.
+ */
+static void ladder_finish(ecc_25519_work_t *out, ecc_25519_scalarmult_state_t *state) {
+	uint32_t A[32], B[32], C[32], D[32], E[32], t0[32], t1[32];
+	uint32_t *const X2 = state->X2, *const Z2 = state->Z2, *const X3 = state->X3, *const Z3 = state->Z3;
+	const uint32_t *const u = state->u, *const v = state->v;
+	uint32_t *const U = A, *const W = C;
+	ecc_25519_work_t res, small;
+	uint32_t b, zQ, zR, xQ;
+
+	ladder_steps(state, state->pos);
+
+	swap_int(X2, X3, state->swap);
+	swap_int(Z2, Z3, state->swap);
+	state->swap = 0;
+
+	/*
+	 * Recover nP = (U:V:W) from P = (u, v), nP = (X2:Z2) and (n+1)P = (X3:Z3):
+	 *
+	 *   V/W = ((u*x2 + 1)(u + x2 + 2A) - 2A - (u - x2)^2 x3) / (2Bv) with B = -(A+2)
+	 */
+	mult(t0, u, Z2);
+	add(A, X2, t0);
+	sub(B, X2, t0);
+	square(t1, B);
+	mult(B, t1, X3);
+
+	mult_int(t0, MONTGOMERY_2A, Z2);
+	add(A, A, t0);
+	mult(C, u, X2);
+	add(C, C, Z2);
+	mult(D, A, C);
+	mult(E, t0, Z2);
+	sub(D, D, E);
+	mult(E, D, Z3);
+	sub(t1, E, B);
+
+	mult_int(t0, MONTGOMERY_2A + 4, v);
+	mult(D, t0, Z2);
+	mult(t0, D, Z3);
+	sub(E, zero, t0);
+	mult(U, E, X2);
+	mult(W, E, Z2);
+
+	/* Map to the Edwards curve: X = U(U+W), Y = V(U-W), Z = V(U+W), T = U(U-W) with V = t1 */
+	add(t0, U, W);
+	sub(D, U, W);
+	mult(res.X, U, t0);
+	mult(res.Y, t1, D);
+	mult(res.Z, t1, t0);
+	mult(res.T, U, D);
+
+	/* nP of order 2: (0, -1) */
+	xQ = check_zero(X2);
+	select_int(res.X, res.X, zero, xQ);
+	sub(t0, zero, one);
+	select_int(res.Y, res.Y, t0, xQ);
+	select_int(res.Z, res.Z, one, xQ);
+	select_int(res.T, res.T, zero, xQ);
+
+	/* nP is the identity */
+	zQ = check_zero(Z2);
+	select_int(res.X, res.X, ecc_25519_work_identity.X, zQ);
+	select_int(res.Y, res.Y, ecc_25519_work_identity.Y, zQ);
+	select_int(res.Z, res.Z, ecc_25519_work_identity.Z, zQ);
+	select_int(res.T, res.T, ecc_25519_work_identity.T, zQ);
+
+	/* (n+1)P is the identity, so nP = -P = (-x, y) with x = u/v and y = (u-1)/(u+1) */
+	zR = check_zero(Z3);
+	add(t0, u, one);
+	sub(t1, u, one);
+	sub(A, zero, u);
+	squeeze(A);
+	mult(B, A, t0);
+	mult(C, v, t1);
+	mult(D, v, t0);
+	mult(E, A, t1);
+	select_int(res.X, res.X, B, zR);
+	select_int(res.Y, res.Y, C, zR);
+	select_int(res.Z, res.Z, D, zR);
+	select_int(res.T, res.T, E, zR);
+
+	b = state->bits ? (state->n.p[0] & 1) : 0;
+	selectw(&small, &ecc_25519_work_identity, &state->base, b);
+	selectw(out, &res, &small, check_zero(state->base.X));
+}
+
+/**
+ * Converts a point into affine coordinates of the Montgomery curve used by \ref ladder_begin
+ *
+ * u = (Z+Y)/(Z-Y) and v = u/x = (Z+Y)Z/((Z-Y)X) are computed using a single reciprocal. Both are zero for the
+ * points with X == 0.
+ */
+static void montgomery_uv(uint32_t u[32], uint32_t v[32], const ecc_25519_work_t *in) {
+	uint32_t t0[32], t1[32], den[32], inv[32];
+
+	sub(t0, in->Z, in->Y);
+	squeeze(t0);
+	mult(den, t0, in->X);
+	recip(inv, den);
+
+	add(t1, in->Z, in->Y);
+	mult(t0, t1, in->X);
+	mult(u, t0, inv);
+	mult(t0, t1, in->Z);
+	mult(v, t0, inv);
+}
+
+void ecc_25519_scalarmult_bits(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base, unsigned bits) {
+	ecc_25519_scalarmult_state_t state;
+	uint32_t u[32], v[32];
+
+	PROBE(scalarmult__entry);
+
+	montgomery_uv(u, v, base);
+	ladder_begin(&state, n, u, v, base, bits);
+	ladder_finish(out, &state);
+
+	PROBE(scalarmult__return);
+}
+
+void ecc_25519_scalarmult(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base) {
+	ecc_25519_scalarmult_bits(out, n, base, 256);
+}
+
+void ecc_25519_scalarmult_base_bits(ecc_25519_work_t *out, const ecc_int256_t *n, unsigned bits) {
+	static const uint32_t default_base_u[32] = {9};
+	ecc_25519_scalarmult_state_t state;
+
+	PROBE(scalarmult_base__entry);
+
+	ladder_begin(&state, n, default_base_u, default_base_v, &ecc_25519_work_default_base, bits);
+	ladder_finish(out, &state);
+
+	PROBE(scalarmult_base__return);
+}
+
+void ecc_25519_scalarmult_base(ecc_25519_work_t *out, const ecc_int256_t *n) {
+	ecc_25519_scalarmult_base_bits(out, n, 256);
+}
+
+void ecc_25519_scalarmult_begin(ecc_25519_scalarmult_state_t *state, const ecc_int256_t *n, const ecc_25519_work_t *base) {
+	uint32_t u[32], v[32];
+
+	montgomery_uv(u, v, base);
+	ladder_begin(state, n, u, v, base, 256);
+}
+
+int ecc_25519_scalarmult_step(ecc_25519_scalarmult_state_t *state, unsigned max_bits) {
+	ladder_steps(state, max_bits);
+	return (state->pos == 0);
+}
+
+void ecc_25519_scalarmult_finish(ecc_25519_scalarmult_state_t *state, ecc_25519_work_t *out) {
+	ladder_finish(out, state);
+}
+
+#ifndef UECC_SMALL
+
+/*
+ * The following functions do the same computations as the ones without the 2 suffix on two independent sets of
+ * operands. The computations are interleaved, so the CPU can execute them in parallel instead of having to wait
+ * for the results of a single long dependency chain.
+ */
+
+/** Two interleaved \ref squeeze operations */
+static void squeeze2(uint32_t a1[32], uint32_t a2[32]) {
+	unsigned int j;
+	uint32_t u1, u2;
+
+	STATS_INC(squeeze);
+	STATS_INC(squeeze);
+
+	u1 = u2 = 0;
+
+	for (j = 0; j < 31; ++j) {
+		u1 += a1[j];
+		u2 += a2[j];
+		a1[j] = u1 & 255;
+		a2[j] = u2 & 255;
+		u1 >>= 8;
+		u2 >>= 8;
+	}
+
+	u1 += a1[31];
+	u2 += a2[31];
+	a1[31] = u1 & 127;
+	a2[31] = u2 & 127;
+	u1 = 19 * (u1 >> 7);
+	u2 = 19 * (u2 >> 7);
+
+	for (j = 0; j < 31; ++j) {
+		u1 += a1[j];
+		u2 += a2[j];
+		a1[j] = u1 & 255;
+		a2[j] = u2 & 255;
+		u1 >>= 8;
+		u2 >>= 8;
+	}
+
+	u1 += a1[31];
+	u2 += a2[31];
+	a1[31] = u1;
+	a2[31] = u2;
+}
+
+/** Two interleaved \ref mult operations */
+static void mult2(uint32_t out1[32], const uint32_t a1[32], const uint32_t b1[32],
+		  uint32_t out2[32], const uint32_t a2[32], const uint32_t b2[32]) {
+	unsigned int i, j;
+	uint32_t u1, u2;
+
+	STATS_INC(mult);
+	STATS_INC(mult);
+
+	for (i = 0; i < 32; ++i) {
+		u1 = u2 = 0;
+
+		for (j = 0; j <= i; j++) {
+			u1 += a1[j] * b1[i - j];
+			u2 += a2[j] * b2[i - j];
+		}
+
+		for (j = i + 1; j < 32; j++) {
+			u1 += 38 * a1[j] * b1[i + 32 - j];
+			u2 += 38 * a2[j] * b2[i + 32 - j];
+		}
+
+		out1[i] = u1;
+		out2[i] = u2;
+	}
+
+	squeeze2(out1, out2);
+}
+
+/** Two interleaved \ref square operations */
+static void square2(uint32_t out1[32], const uint32_t a1[32], uint32_t out2[32], const uint32_t a2[32]) {
+	unsigned int i, j;
+	uint32_t u1, u2;
+
+	STATS_INC(square);
+	STATS_INC(square);
+
+	for (i = 0; i < 32; i++) {
+		u1 = u2 = 0;
+
+		for (j = 0; j < i - j; j++) {
+			u1 += a1[j] * a1[i - j];
+			u2 += a2[j] * a2[i - j];
+		}
+
+		for (j = i + 1; j < i + 32 - j; j++) {
+			u1 += 38 * a1[j] * a1[i + 32 - j];
+			u2 += 38 * a2[j] * a2[i + 32 - j];
+		}
+
+		u1 *= 2;
+		u2 *= 2;
+
+		if ((i & 1) == 0) {
+			u1 += a1[i / 2] * a1[i / 2];
+			u2 += a2[i / 2] * a2[i / 2];
+			u1 += 38 * a1[i / 2 + 16] * a1[i / 2 + 16];
+			u2 += 38 * a2[i / 2 + 16] * a2[i / 2 + 16];
+		}
+
+		out1[i] = u1;
+		out2[i] = u2;
+	}
+
+	squeeze2(out1, out2);
+}
+
+/** Does all remaining steps of two Montgomery ladders with the same number of bits at once */
+static void ladder_steps2(ecc_25519_scalarmult_state_t *s1, ecc_25519_scalarmult_state_t *s2) {
+	uint32_t A1[32], AA1[32], B1[32], BB1[32], C1[32], D1[32], E1[32], DA1[32], CB1[32], t01[32], t11[32];
+	uint32_t A2[32], AA2[32], B2[32], BB2[32], C2[32], D2[32], E2[32], DA2[32], CB2[32], t02[32], t12[32];
+	uint32_t b1, b2;
+	unsigned pos;
+
+	while (s1->pos > 0) {
+		pos = --s1->pos;
+		--s2->pos;
+
+		b1 = s1->n.p[pos / 8] >> (pos & 7);
+		b2 = s2->n.p[pos / 8] >> (pos & 7);
+		b1 &= 1;
+		b2 &= 1;
+
+		s1->swap ^= b1;
+		s2->swap ^= b2;
+		swap_int(s1->X2, s1->X3, s1->swap);
+		swap_int(s2->X2, s2->X3, s2->swap);
+		swap_int(s1->Z2, s1->Z3, s1->swap);
+		swap_int(s2->Z2, s2->Z3, s2->swap);
+		s1->swap = b1;
+		s2->swap = b2;
+
+		add(A1, s1->X2, s1->Z2);
+		add(A2, s2->X2, s2->Z2);
+		sub(B1, s1->X2, s1->Z2);
+		sub(B2, s2->X2, s2->Z2);
+		square2(AA1, A1, AA2, A2);
+		square2(BB1, B1, BB2, B2);
+		sub(E1, AA1, BB1);
+		sub(E2, AA2, BB2);
+
+		add(C1, s1->X3, s1->Z3);
+		add(C2, s2->X3, s2->Z3);
+		sub(D1, s1->X3, s1->Z3);
+		sub(D2, s2->X3, s2->Z3);
+		mult2(DA1, D1, A1, DA2, D2, A2);
+		mult2(CB1, C1, B1, CB2, C2, B2);
+
+		add(t01, DA1, CB1);
+		add(t02, DA2, CB2);
+		square2(s1->X3, t01, s2->X3, t02);
+		sub(t01, DA1, CB1);
+		sub(t02, DA2, CB2);
+		square2(t11, t01, t12, t02);
+		mult2(s1->Z3, t11, s1->u, s2->Z3, t12, s2->u);
+
+		mult2(s1->X2, AA1, BB1, s2->X2, AA2, BB2);
+		mult_int(t01, MONTGOMERY_A24, E1);
+		mult_int(t02, MONTGOMERY_A24, E2);
+		add(t11, BB1, t01);
+		add(t12, BB2, t02);
+		mult2(s1->Z2, E1, t11, s2->Z2, E2, t12);
+	}
+}
+
+#endif
+
+void ecc_25519_scalarmult_x2(ecc_25519_work_t *out1, const ecc_int256_t *n1, const ecc_25519_work_t *base1,
+			     ecc_25519_work_t *out2, const ecc_int256_t *n2, const ecc_25519_work_t *base2) {
+	ecc_25519_scalarmult_state_t state1, state2;
+
+	PROBE(scalarmult_x2__entry);
+
+	ecc_25519_scalarmult_begin(&state1, n1, base1);
+	ecc_25519_scalarmult_begin(&state2, n2, base2);
+
+	/* With UECC_SMALL, the ladders are stepped one after the other by ladder_finish */
+#ifndef UECC_SMALL
+	ladder_steps2(&state1, &state2);
+#endif
+
+	ladder_finish(out1, &state1);
+	ladder_finish(out2, &state2);
+
+	PROBE(scalarmult_x2__return);
+}
+
+void ecc_25519_enum_init(ecc_25519_enum_t *e, const ecc_int256_t *start, const ecc_int256_t *step) {
+	uint32_t Zinv[32];
+	int i;
+
+	ecc_25519_scalarmult_base(&e->cur, start);
+	ecc_25519_scalarmult_base(&e->step, step);
+
+	/* Normalize the step to Z == 1 for the mixed addition */
+	recip(Zinv, e->step.Z);
+	mult(e->step.T, e->step.X, Zinv);
+	mult(e->step.Z, e->step.Y, Zinv);
+
+	for (i = 0; i < 32; i++) {
+		e->step.X[i] = e->step.T[i];
+		e->step.Y[i] = e->step.Z[i];
+		e->step.Z[i] = (i == 0);
+	}
+
+	mult(e->step.T, e->step.X, e->step.Y);
+}
+
+/**
+ * Emits up to \ref ECC_25519_ENUM_BLOCK points of an enumeration in the Ed25519, legacy or Montgomery format
+ *
+ * Each point is computed with a single mixed addition. The coordinates are kept in e->block until a
+ * single reciprocal for the whole block has been computed using Montgomery's trick; the running products
+ * of the denominators are kept in the output array.
+ */
+static void enum_block(ecc_25519_enum_t *e, ecc_int256_t *out, size_t n, ecc_25519_format_t format) {
+	uint32_t acc[32], a[32], b[32], den[32], t0[32];
+	size_t i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		if (format == ECC_25519_FORMAT_MONTGOMERY) {
+			/* u = (Z+Y)/(Z-Y); the identity is stored as u = 0 */
+			add(a, e->cur.Z, e->cur.Y);
+			squeeze(a);
+			sub(den, e->cur.Z, e->cur.Y);
+			squeeze(den);
+
+			j = check_zero(den);
+			select_int(a, a, zero, j);
+			select_int(den, den, one, j);
+		}
+		else {
+			for (j = 0; j < 32; j++) {
+				a[j] = e->cur.X[j];
+				b[j] = e->cur.Y[j];
+				den[j] = e->cur.Z[j];
+			}
+		}
+
+		for (j = 0; j < 32; j++) {
+			e->block[i][0][j] = a[j];
+			e->block[i][1][j] = b[j];
+			e->block[i][2][j] = den[j];
+		}
+
+		if (i == 0) {
+			for (j = 0; j < 32; j++)
+				acc[j] = den[j];
+		}
+		else {
+			mult(t0, acc, den);
+			for (j = 0; j < 32; j++)
+				acc[j] = t0[j];
+		}
+
+		for (j = 0; j < 32; j++)
+			out[i].p[j] = acc[j];
+
+		ecc_25519_add1(&e->cur, &e->cur, &e->step);
+	}
+
+	recip(t0, acc);
+	for (j = 0; j < 32; j++)
+		acc[j] = t0[j];
+
+	for (i = n; i-- > 0;) {
+		/* acc is the reciprocal of the product of the first i+1 denominators */
+		if (i > 0) {
+			for (j = 0; j < 32; j++) {
+				t0[j] = out[i-1].p[j];
+				den[j] = e->block[i][2][j];
+			}
+
+			mult(b, acc, t0);
+			mult(t0, acc, den);
+			for (j = 0; j < 32; j++) {
+				acc[j] = t0[j];
+				den[j] = b[j];
+			}
+		}
+		else {
+			for (j = 0; j < 32; j++)
+				den[j] = acc[j];
+		}
+
+		/* den is the reciprocal of the denominator of point i now */
+		for (j = 0; j < 32; j++)
+			t0[j] = e->block[i][0][j];
+		mult(a, t0, den);
+
+		if (format == ECC_25519_FORMAT_MONTGOMERY) {
+			freeze(a);
+
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = a[j];
+
+			continue;
+		}
+
+		for (j = 0; j < 32; j++)
+			t0[j] = e->block[i][1][j];
+		mult(b, t0, den);
+
+		if (format == ECC_25519_FORMAT_LEGACY) {
+			mult(t0, a, ed25519_to_legacy);
+			freeze(t0);
+			freeze(b);
+
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = t0[j];
+			out[i].p[31] |= (b[0] << 7);
+		}
+		else {
+			freeze(a);
+			freeze(b);
+
+			for (j = 0; j < 32; j++)
+				out[i].p[j] = b[j];
+			out[i].p[31] |= (a[0] << 7);
+		}
+	}
+}
+
+void ecc_25519_enum_next(ecc_25519_enum_t *e, ecc_int256_t *out, size_t count, ecc_25519_format_t format) {
+	size_t i, n;
+
+	if (format == ECC_25519_FORMAT_RISTRETTO255) {
+		/* The Ristretto255 encoding needs an inverse square root per point anyway */
+		for (i = 0; i < count; i++) {
+			ecc_25519_store_packed_ristretto255(&out[i], &e->cur);
+			ecc_25519_add1(&e->cur, &e->cur, &e->step);
+		}
+
+		return;
+	}
+
+	for (i = 0; i < count; i += n) {
+		n = count - i;
+		if (n > ECC_25519_ENUM_BLOCK)
+			n = ECC_25519_ENUM_BLOCK;
+
+		enum_block(e, out+i, n, format);
+	}
+}
+
+/**
+ * Computes the width-w non-adjacent form of an integer
+ *
+ * All non-zero digits of the result are odd and in the range \f$ (-2^{w-1}, 2^{w-1}) \f$, and
+ * of any w consecutive digits, at most one is non-zero.
+ *
+ * The returned value is the number of digits up to the highest non-zero digit.
+ * This function doesn't run in constant time.
+ */
+static int recode_wnaf(int8_t naf[257], const ecc_int256_t *n, unsigned w) {
+	uint32_t v[9] = {0};
+	int32_t digit;
+	int i, j, len = 0;
+
+	for (i = 0; i < 32; i++)
+		v[i/4] |= (uint32_t)n->p[i] << (8*(i%4));
+
+	for (i = 0; i < 257; i++) {
+		naf[i] = 0;
+
+		if (v[0] & 1) {
+			digit = v[0] & ((1 << w) - 1);
+			if (digit >= (1 << (w-1)))
+				digit -= (1 << w);
+
+			naf[i] = digit;
+			len = i+1;
+
+			if (digit > 0) {
+				v[0] -= digit;
+			}
+			else {
+				v[0] += -digit;
+
+				/* Propagate the carry */
+				if (v[0] < (uint32_t)-digit) {
+					for (j = 1; j < 9 && !++v[j]; j++) {}
+				}
+			}
+		}
+
+		for (j = 0; j < 8; j++)
+			v[j] = (v[j] >> 1) | (v[j+1] << 31);
+		v[8] >>= 1;
+	}
+
+	return len;
+}
+
+/** Width of the wNAF used by \ref ecc_25519_scalarmult_vartime */
+#ifdef UECC_SMALL
+#define VARTIME_WINDOW 4
+#else
+#define VARTIME_WINDOW 5
+#endif
+
+/**
+ * A point in cached form for \ref add_cached
+ *
+ * The cached form contains the values of the second point needed by \ref ecc_25519_add, with the
+ * multiplications with small constants already done. All values are squeezed, so they are stored in single bytes.
+ */
+typedef struct cached {
+	uint8_t YpX[32];	/**< \f$ j(Y+X) \f$ */
+	uint8_t YmX[32];	/**< \f$ j(Y-X) \f$ */
+	uint8_t T[32];		/**< \f$ kT \f$ */
+	uint8_t Z[32];		/**< \f$ 2jZ \f$ */
+} cached_t;
+
+/** Converts a point to cached form */
+static void store_cached(cached_t *out, const ecc_25519_work_t *in) {
+	const uint32_t j = UINT32_C(60833);
+	const uint32_t k = UINT32_C(121665);
+	uint32_t t0[32], t1[32];
+	int i;
+
+	add(t0, in->Y, in->X);
+	mult_int(t1, j, t0);
+	for (i = 0; i < 32; i++)
+		out->YpX[i] = t1[i];
+
+	sub(t0, in->Y, in->X);
+	mult_int(t1, j, t0);
+	for (i = 0; i < 32; i++)
+		out->YmX[i] = t1[i];
+
+	mult_int(t1, k, in->T);
+	for (i = 0; i < 32; i++)
+		out->T[i] = t1[i];
+
+	mult_int(t1, 2*j, in->Z);
+	for (i = 0; i < 32; i++)
+		out->Z[i] = t1[i];
+}
+
+/**
+ * Adds a point in cached form to another point (or subtracts it if neg is set)
+ *
+ * This is \ref ecc_25519_add without the multiplications with small constants.
+ * The same pointer may be given for in1 and out.
+ */
+static void add_cached(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const cached_t *in2, int neg) {
+	/* The buffers are reused as soon as their values aren't needed anymore (A -> F, B -> G) */
+	uint32_t A[32], B[32], C[32], D[32], E[32], H[32], t0[32];
+	uint32_t *const F = A, *const G = B;
+	int i;
+
+	/* Negating the second point swaps Y+X and Y-X and negates T */
+	for (i = 0; i < 32; i++)
+		t0[i] = neg ? in2->YpX[i] : in2->YmX[i];
+	sub(E, in1->Y, in1->X);
+	mult(A, E, t0);
+
+	for (i = 0; i < 32; i++)
+		t0[i] = neg ? in2->YmX[i] : in2->YpX[i];
+	add(E, in1->Y, in1->X);
+	mult(B, E, t0);
+
+	for (i = 0; i < 32; i++)
+		t0[i] = in2->T[i];
+	mult(C, in1->T, t0);
+
+	for (i = 0; i < 32; i++)
+		t0[i] = in2->Z[i];
+	mult(D, in1->Z, t0);
+
+	sub(E, B, A);
+	add(H, B, A);
+
+	if (neg) {
+		sub(F, D, C);
+		add(G, D, C);
+	}
+	else {
+		add(F, D, C);
+		sub(G, D, C);
+	}
+
+	mult(out->X, E, F);
+	mult(out->Y, G, H);
+	mult(out->T, E, H);
+	mult(out->Z, F, G);
+}
+
+/**
+ * Adds a point in cached form with a Z value of 1 to another point (or subtracts it if neg is set)
+ *
+ * This is \ref add_cached without the multiplication with the Z value, like \ref ecc_25519_add1.
+ * The same pointer may be given for in1 and out.
+ */
+static void add_cached1(ecc_25519_work_t *out, const ecc_25519_work_t *in1, const cached_t *in2, int neg) {
+	/* The buffers are reused as soon as their values aren't needed anymore (A -> F, B -> G) */
+	uint32_t A[32], B[32], C[32], E[32], H[32], t0[32];
+	uint32_t *const F = A, *const G = B;
+	const uint32_t *const D = in1->Z;
+	int i;
+
+	/* Negating the second point swaps Y+X and Y-X and negates T */
+	for (i = 0; i < 32; i++)
+		t0[i] = neg ? in2->YpX[i] : in2->YmX[i];
+	sub(E, in1->Y, in1->X);
+	mult(A, E, t0);
+
+	for (i = 0; i < 32; i++)
+		t0[i] = neg ? in2->YmX[i] : in2->YpX[i];
+	add(E, in1->Y, in1->X);
+	mult(B, E, t0);
+
+	for (i = 0; i < 32; i++)
+		t0[i] = in2->T[i];
+	mult(C, in1->T, t0);
+
+	sub(E, B, A);
+	add(H, B, A);
+
+	if (neg) {
+		sub(F, D, C);
+		add(G, D, C);
+	}
+	else {
+		add(F, D, C);
+		sub(G, D, C);
+	}
+
+	mult(out->X, E, F);
+	mult(out->Y, G, H);
+	mult(out->T, E, H);
+	mult(out->Z, F, G);
+}
+
+/**
+ * Divides points in cached form by their Z values, so they can be used with \ref add_cached1
+ *
+ * All values of the cached form are linear in the coordinates of the point, so this doesn't change the point. The
+ * reciprocal is shared by all points (Montgomery's trick); prod must have space for n running products.
+ */
+static void normalize_cached(cached_t *table, uint8_t (*prod)[32], size_t n) {
+	uint32_t acc[32], inv[32], t0[32], t1[32];
+	size_t k;
+	int i;
+
+	for (i = 0; i < 32; i++)
+		acc[i] = prod[0][i] = table[0].Z[i];
+
+	for (k = 1; k < n; k++) {
+		for (i = 0; i < 32; i++)
+			t1[i] = table[k].Z[i];
+		mult(t0, acc, t1);
+
+		for (i = 0; i < 32; i++)
+			acc[i] = prod[k][i] = t0[i];
+	}
+
+	recip(t0, acc);
+	for (i = 0; i < 32; i++)
+		acc[i] = t0[i];
+
+	for (k = n; k-- > 0;) {
+		/* acc is the reciprocal of the product of the Z values of the first k+1 points */
+		if (k > 0) {
+			for (i = 0; i < 32; i++)
+				t1[i] = prod[k-1][i];
+			mult(inv, acc, t1);
+
+			for (i = 0; i < 32; i++)
+				t1[i] = table[k].Z[i];
+			mult(t0, acc, t1);
+			for (i = 0; i < 32; i++)
+				acc[i] = t0[i];
+		}
+		else {
+			for (i = 0; i < 32; i++)
+				inv[i] = acc[i];
+		}
+
+		for (i = 0; i < 32; i++)
+			t1[i] = table[k].YpX[i];
+		mult(t0, t1, inv);
+		for (i = 0; i < 32; i++)
+			table[k].YpX[i] = t0[i];
+
+		for (i = 0; i < 32; i++)
+			t1[i] = table[k].YmX[i];
+		mult(t0, t1, inv);
+		for (i = 0; i < 32; i++)
+			table[k].YmX[i] = t0[i];
+
+		for (i = 0; i < 32; i++)
+			t1[i] = table[k].T[i];
+		mult(t0, t1, inv);
+		for (i = 0; i < 32; i++) {
+			table[k].T[i] = t0[i];
+			table[k].Z[i] = (i == 0);
+		}
+	}
+}
+
+void ecc_25519_scalarmult_vartime(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base) {
+	/* Precomputed odd multiples 1, 3, 5, ... of the base, normalized to Z == 1 */
+	cached_t table[1 << (VARTIME_WINDOW-2)];
+	uint8_t prod[1 << (VARTIME_WINDOW-2)][32];
+	ecc_25519_work_t cur, base2;
+	int8_t naf[257];
+	int i, len;
+
+	PROBE(scalarmult_vartime__entry);
+
+	len = recode_wnaf(naf, n, VARTIME_WINDOW);
+	if (!len) {
+		*out = ecc_25519_work_identity;
+		PROBE(scalarmult_vartime__return);
+		return;
+	}
+
+	ecc_25519_double(&base2, base);
+	cur = *base;
+	store_cached(&table[0], &cur);
+
+	for (i = 1; i < (1 << (VARTIME_WINDOW-2)); i++) {
+		ecc_25519_add(&cur, &cur, &base2);
+		store_cached(&table[i], &cur);
+	}
+
+	normalize_cached(table, prod, 1 << (VARTIME_WINDOW-2));
+
+	/* The highest digit is always positive */
+	add_cached1(&cur, &ecc_25519_work_identity, &table[naf[len-1]/2], 0);
+
+	for (i = len-2; i >= 0; i--) {
+		/* T is only needed by the additions and for the result */
+		double_point(&cur, &cur, naf[i] != 0 || i == 0);
+
+		if (naf[i] > 0)
+			add_cached1(&cur, &cur, &table[naf[i]/2], 0);
+		else if (naf[i] < 0)
+			add_cached1(&cur, &cur, &table[-naf[i]/2], 1);
+	}
+
+	*out = cur;
+
+	PROBE(scalarmult_vartime__return);
+}
+
+void ecc_25519_fixed_base_init(ecc_25519_fixed_base_t *table, const ecc_25519_work_t *base) {
+	cached_t *entries = (cached_t *)table->entries;
+	ecc_25519_work_t row, cur;
+	int i, j;
+
+	row = *base;
+
+	for (i = 0; i < 32; i++) {
+		/* Entry j of row i is (j+1) * 256^i * base */
+		cur = row;
+		store_cached(&entries[8*i], &cur);
+
+		for (j = 1; j < 8; j++) {
+			ecc_25519_add(&cur, &cur, &row);
+			store_cached(&entries[8*i + j], &cur);
+		}
+
+		/* 256^(i+1) * base = 2 * (8 * 256^i * base) * 16 */
+		ecc_25519_double(&row, &cur);
+		for (j = 0; j < 4; j++)
+			ecc_25519_double(&row, &row);
+	}
+}
+
+/**
+ * Recodes an integer into 65 signed radix-16 digits in \f$ [-8,8] \f$
+ *
+ * The last digit is the final carry, which is 0 or 1. The recoding is done in constant time.
+ */
+static void recode_radix16(int8_t e[65], const ecc_int256_t *n) {
+	int8_t carry = 0;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		e[2*i] = n->p[i] & 15;
+		e[2*i+1] = n->p[i] >> 4;
+	}
+
+	for (i = 0; i < 64; i++) {
+		e[i] += carry;
+		carry = (e[i] + 8) >> 4;
+		e[i] -= carry << 4;
+	}
+	e[64] = carry;
+}
+
+/**
+ * Selects the multiple digit * P from a row of a fixed base table in constant time
+ *
+ * The row contains the multiples 1 * P to 8 * P; digit must be in \f$ [-8,8] \f$.
+ */
+static void select_fixed(cached_t *out, const cached_t row[8], int8_t digit) {
+	const uint32_t j = UINT32_C(60833);
+	uint32_t neg = ((uint32_t)(int32_t)digit) >> 31;
+	uint32_t babs = digit - ((-neg) & ((uint32_t)digit << 1));
+	uint32_t T[32], Tneg[32];
+	uint8_t mask, t;
+	int i, k;
+
+	/* Start with the identity, which is (j, j, 0, 2j) in cached form */
+	for (i = 0; i < 32; i++) {
+		out->YpX[i] = out->YmX[i] = out->T[i] = out->Z[i] = 0;
+	}
+	out->YpX[0] = out->YmX[0] = j & 0xff;
+	out->YpX[1] = out->YmX[1] = j >> 8;
+	out->Z[0] = (2*j) & 0xff;
+	out->Z[1] = ((2*j) >> 8) & 0xff;
+	out->Z[2] = (2*j) >> 16;
+
+	for (k = 0; k < 8; k++) {
+		mask = -(uint8_t)(((babs ^ (k+1)) - 1) >> 31);
+
+		for (i = 0; i < 32; i++) {
+			out->YpX[i] ^= mask & (out->YpX[i] ^ row[k].YpX[i]);
+			out->YmX[i] ^= mask & (out->YmX[i] ^ row[k].YmX[i]);
+			out->T[i] ^= mask & (out->T[i] ^ row[k].T[i]);
+			out->Z[i] ^= mask & (out->Z[i] ^ row[k].Z[i]);
+		}
+	}
+
+	/* Negating the point swaps Y+X and Y-X and negates T */
+	mask = -(uint8_t)neg;
+	for (i = 0; i < 32; i++) {
+		t = mask & (out->YpX[i] ^ out->YmX[i]);
+		out->YpX[i] ^= t;
+		out->YmX[i] ^= t;
+
+		T[i] = out->T[i];
+	}
+
+	sub(Tneg, zero, T);
+	squeeze(Tneg);
+	select_int(T, T, Tneg, neg);
+
+	for (i = 0; i < 32; i++)
+		out->T[i] = T[i];
+}
+
+/**
+ * Does a joint scalar multiplication with one or two fixed base tables
+ *
+ * The four doublings needed to combine the odd and even digits are shared by both tables.
+ */
+static void scalarmult_fixed(ecc_25519_work_t *out, const ecc_int256_t *n1, const ecc_25519_fixed_base_t *table1,
+			     const ecc_int256_t *n2, const ecc_25519_fixed_base_t *table2) {
+	const cached_t *entries1 = (const cached_t *)table1->entries, *entries2 = NULL;
+	int8_t e1[65], e2[65];
+	ecc_25519_work_t cur = ecc_25519_work_identity;
+	ecc_int256_t r;
+	cached_t c;
+	int i, j;
+
+	/* As the reduced integers are less than 2^253, the final carries of the recoding are always 0 */
+	ecc_25519_gf_reduce(&r, n1);
+	recode_radix16(e1, &r);
+	if (table2) {
+		entries2 = (const cached_t *)table2->entries;
+		ecc_25519_gf_reduce(&r, n2);
+		recode_radix16(e2, &r);
+	}
+
+	/* Odd digits first, which are multiplied by 16 afterwards */
+	for (j = 1; j >= 0; j--) {
+		for (i = j; i < 64; i += 2) {
+			select_fixed(&c, &entries1[8*(i/2)], e1[i]);
+			add_cached(&cur, &cur, &c, 0);
+
+			if (table2) {
+				select_fixed(&c, &entries2[8*(i/2)], e2[i]);
+				add_cached(&cur, &cur, &c, 0);
+			}
+		}
+
+		if (j) {
+			ecc_25519_double(&cur, &cur);
+			ecc_25519_double(&cur, &cur);
+			ecc_25519_double(&cur, &cur);
+			ecc_25519_double(&cur, &cur);
+		}
+	}
+
+	*out = cur;
+}
+
+void ecc_25519_scalarmult_fixed(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_fixed_base_t *table) {
+	PROBE(scalarmult_fixed__entry);
+	scalarmult_fixed(out, n, table, NULL, NULL);
+	PROBE(scalarmult_fixed__return);
+}
+
+void ecc_25519_scalarmult_fixed_joint(ecc_25519_work_t *out, const ecc_int256_t *n1, const ecc_25519_fixed_base_t *table1,
+				      const ecc_int256_t *n2, const ecc_25519_fixed_base_t *table2) {
+	PROBE(scalarmult_fixed_joint__entry);
+	scalarmult_fixed(out, n1, table1, n2, table2);
+	PROBE(scalarmult_fixed_joint__return);
+}
+
+void ecc_25519_scalarmult_base_ctx(ecc_25519_ctx_t *ctx, ecc_25519_work_t *out, const ecc_int256_t *n) {
+	/* The default base point is in the prime order subgroup, so reducing n doesn't change the result */
+	if (ctx->base_table)
+		ecc_25519_scalarmult_fixed(out, n, ctx->base_table);
+	else
+		ecc_25519_scalarmult_base(out, n);
+}
+
+/**
+ * Computes the denominator (Z-Y)X of the coordinates of a point on the Montgomery curve (see \ref montgomery_uv)
+ *
+ * The denominator is zero for the points with X == 0; one is returned instead, so it can be part of a product of
+ * denominators for Montgomery's trick.
+ */
+static void montgomery_den(uint32_t den[32], const ecc_25519_work_t *in) {
+	uint32_t t0[32];
+
+	sub(t0, in->Z, in->Y);
+	squeeze(t0);
+	mult(den, t0, in->X);
+
+	select_int(den, den, one, check_zero(den));
+}
+
+void ecc_25519_scalarmult_many(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *bases, size_t count) {
+	ecc_25519_scalarmult_state_t state[2];
+	ecc_25519_work_t base[2];
+	uint32_t acc[32], den[32], inv[32], u[32], v[32], t0[32], t1[32];
+	size_t start, k, m, g;
+	int i;
+
+	PROBE(scalarmult_many__entry);
+
+	if (!count) {
+		PROBE(scalarmult_many__return);
+		return;
+	}
+
+	/*
+	 * The conversions to the Montgomery curve share a single reciprocal (Montgomery's trick). The running
+	 * products of the denominators are kept in the T coordinates of the outputs; as the conversion only
+	 * needs X, Y and Z, this works when out is the same array as bases.
+	 */
+	montgomery_den(acc, &bases[0]);
+	for (i = 0; i < 32; i++)
+		out[0].T[i] = acc[i];
+
+	for (k = 1; k < count; k++) {
+		montgomery_den(den, &bases[k]);
+		mult(t0, acc, den);
+
+		for (i = 0; i < 32; i++)
+			acc[i] = out[k].T[i] = t0[i];
+	}
+
+	recip(t0, acc);
+	for (i = 0; i < 32; i++)
+		acc[i] = t0[i];
+
+	/* The bases are converted back to front, so each output is only overwritten after its base has been used */
+	for (start = count; start > 0; start -= m) {
+		m = (start > 1) ? 2 : 1;
+
+		for (g = 0; g < m; g++) {
+			k = start - 1 - g;
+			base[g] = bases[k];
+
+			/*
+			 * The T coordinate of the base may have been overwritten by the running products; ladder_finish
+			 * only returns the base itself when X == 0, which makes T zero
+			 */
+			select_int(base[g].T, base[g].T, zero, check_zero(base[g].X));
+
+			/* acc is the reciprocal of the product of the denominators of the first k+1 bases */
+			montgomery_den(den, &base[g]);
+			if (k > 0) {
+				mult(inv, acc, out[k-1].T);
+				mult(t0, acc, den);
+				for (i = 0; i < 32; i++)
+					acc[i] = t0[i];
+			}
+			else {
+				for (i = 0; i < 32; i++)
+					inv[i] = acc[i];
+			}
+
+			/* Like montgomery_uv, but u and v are zero for X == 0 without the reciprocal of zero */
+			add(t1, base[g].Z, base[g].Y);
+			mult(t0, t1, base[g].X);
+			mult(u, t0, inv);
+			mult(t0, t1, base[g].Z);
+			mult(v, t0, inv);
+			select_int(v, v, zero, check_zero(base[g].X));
+
+			ladder_begin(&state[g], n, u, v, &base[g], 256);
+		}
+
+		/* With UECC_SMALL, or for a single remaining base, the ladders are stepped one after the other by ladder_finish */
+#ifndef UECC_SMALL
+		if (m == 2)
+			ladder_steps2(&state[0], &state[1]);
+#endif
+
+		for (g = 0; g < m; g++)
+			ladder_finish(&out[start-1-g], &state[g]);
+	}
+
+	PROBE(scalarmult_many__return);
+}
+
+/** Number of bits of each integer processed per step of \ref ecc_25519_scalarmult_joint */
+#ifdef UECC_SMALL
+#define JOINT_WINDOW 1
+#else
+#define JOINT_WINDOW 2
+#endif
+
+/** Copies entry index of a table of points in cached form into out in constant time */
+static void select_cached(cached_t *out, const cached_t *table, unsigned size, uint32_t index) {
+	uint8_t mask;
+	unsigned i, k;
+
+	for (i = 0; i < 32; i++)
+		out->YpX[i] = out->YmX[i] = out->T[i] = out->Z[i] = 0;
+
+	for (k = 0; k < size; k++) {
+		mask = -(uint8_t)(((index ^ k) - 1) >> 31);
+
+		for (i = 0; i < 32; i++) {
+			out->YpX[i] |= mask & table[k].YpX[i];
+			out->YmX[i] |= mask & table[k].YmX[i];
+			out->T[i] |= mask & table[k].T[i];
+			out->Z[i] |= mask & table[k].Z[i];
+		}
+	}
+}
+
+void ecc_25519_scalarmult_joint(ecc_25519_work_t *out, const ecc_int256_t *n1, const ecc_25519_work_t *base1,
+				const ecc_int256_t *n2, const ecc_25519_work_t *base2) {
+	const unsigned mask = (1 << JOINT_WINDOW) - 1;
+
+	/* Entry i + (j << JOINT_WINDOW) is i * base1 + j * base2 */
+	cached_t table[1 << (2*JOINT_WINDOW)];
+	ecc_25519_work_t row[1 << JOINT_WINDOW];
+	ecc_25519_work_t cur = ecc_25519_work_identity;
+	cached_t c;
+	uint32_t index;
+	unsigned i, j;
+	int pos;
+
+	PROBE(scalarmult_joint__entry);
+
+	row[0] = ecc_25519_work_identity;
+	for (i = 1; i <= mask; i++)
+		ecc_25519_add(&row[i], &row[i-1], base1);
+
+	for (j = 0; j <= mask; j++) {
+		for (i = 0; i <= mask; i++) {
+			if (j)
+				ecc_25519_add(&row[i], &row[i], base2);
+
+			store_cached(&table[i + (j << JOINT_WINDOW)], &row[i]);
+		}
+	}
+
+	for (pos = 256 - JOINT_WINDOW; pos >= 0; pos -= JOINT_WINDOW) {
+		for (i = 0; i < JOINT_WINDOW; i++)
+			ecc_25519_double(&cur, &cur);
+
+		/* As JOINT_WINDOW divides 8, the bits of a window are always in the same byte */
+		index = (n1->p[pos / 8] >> (pos & 7)) & mask;
+		index |= ((n2->p[pos / 8] >> (pos & 7)) & mask) << JOINT_WINDOW;
+
+		select_cached(&c, table, 1 << (2*JOINT_WINDOW), index);
+		add_cached(&cur, &cur, &c, 0);
+	}
+
+	*out = cur;
+
+	PROBE(scalarmult_joint__return);
+}
+
+int ecc_25519_in_prime_subgroup(const ecc_25519_work_t *in) {
+	ecc_25519_work_t P;
+	int ret;
+
+	PROBE(in_prime_subgroup__entry);
+
+#ifdef UECC_SMALL
+	/* Use the ladder to avoid the stack space of the wNAF and the precomputed multiples */
+	ecc_25519_scalarmult_bits(&P, &ecc_25519_gf_order, in, 253);
+#else
+	ecc_25519_scalarmult_vartime(&P, &ecc_25519_gf_order, in);
+#endif
+	ret = ecc_25519_is_identity(&P);
+
+	PROBE(in_prime_subgroup__return);
+	return ret;
+}
+
+/**
+ * Checks if the point with the given u coordinate has small order
+ *
+ * This is the case if doubling it three times yields the identity (Z == 0). As only u is used, this works for
+ * points of the Montgomery curve and of its twist alike.
+ */
+static int montgomery_small_order(const uint32_t u[32]) {
+	uint32_t X[32], Z[32], A[32], AA[32], B[32], BB[32], E[32], t0[32], t1[32];
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		X[i] = u[i];
+		Z[i] = (i == 0);
+	}
+
+	for (i = 0; i < 3; i++) {
+		add(A, X, Z);
+		square(AA, A);
+		sub(B, X, Z);
+		square(BB, B);
+		sub(E, AA, BB);
+
+		mult(X, AA, BB);
+		mult_int(t0, MONTGOMERY_A24, E);
+		add(t1, BB, t0);
+		mult(Z, E, t1);
+	}
+
+	return check_zero(Z);
+}
+
+/**
+ * Computes a Diffie-Hellman shared secret in the Montgomery format
+ *
+ * Like X25519, only the steps of the Montgomery ladder are run on the u coordinate of the peer: it isn't
+ * decompressed, the v coordinate of the result isn't recovered, and the only reciprocal is needed for the
+ * output. For points of the curve, the result is the same as with the full point; points of the twist are
+ * accepted as well.
+ */
+static int ecdh_montgomery(ecc_int256_t *out, const ecc_int256_t *secret, const ecc_int256_t *peer) {
+	ecc_25519_scalarmult_state_t state;
+	uint32_t u[32], inv[32];
+	int i;
+
+	for (i = 0; i < 32; i++)
+		u[i] = peer->p[i];
+
+	u[31] &= 0x7f;
+
+	if (montgomery_small_order(u)) {
+		for (i = 0; i < 32; i++)
+			out->p[i] = 0;
+
+		return 0;
+	}
+
+	ladder_begin(&state, secret, u, zero, &ecc_25519_work_identity, 256);
+	ladder_steps(&state, 256);
+
+	swap_int(state.X2, state.X3, state.swap);
+	swap_int(state.Z2, state.Z3, state.swap);
+
+	/* As for the packed identity, the result is zero when nP is the identity (Z2 == 0) */
+	recip(inv, state.Z2);
+	mult(u, state.X2, inv);
+	freeze(u);
+
+	for (i = 0; i < 32; i++)
+		out->p[i] = u[i];
+
+	return 1;
+}
+
+int ecc_25519_ecdh_packed(ecc_int256_t *out, const ecc_int256_t *secret, const ecc_int256_t *peer, ecc_25519_format_t format) {
+	ecc_25519_work_t work;
+	int i, ret;
+
+	PROBE(ecdh__entry);
+
+	if (format == ECC_25519_FORMAT_MONTGOMERY) {
+		ret = ecdh_montgomery(out, secret, peer);
+
+		PROBE(ecdh__return);
+		return ret;
+	}
+
+	/*
+	 * The other formats aren't fused: the ladder needs the u coordinate of the decompressed point, and
+	 * computing it saves at most a reciprocal, which is lost in the noise of the scalar multiplication
+	 */
+	if (!load_packed(&work, peer, format) || ecc_25519_is_small_order(&work)) {
+		for (i = 0; i < 32; i++)
+			out->p[i] = 0;
+
+		PROBE(ecdh__return);
+		return 0;
+	}
+
+	ecc_25519_scalarmult_bits(&work, secret, &work, 256);
+
+	store_packed(out, &work, format);
+
+	PROBE(ecdh__return);
+	return 1;
+}
+
+int ecc_25519_fhmqv_packed(ecc_int256_t *out, const ecc_int256_t *y, const ecc_int256_t *b, const ecc_int256_t *e, const ecc_int256_t *d,
+			   const ecc_int256_t *X, const ecc_int256_t *A, ecc_25519_format_t format) {
+	ecc_25519_work_t X_work, A_work, work;
+	ecc_int256_t s1, s2;
+	int i, ret = 0;
+
+	PROBE(fhmqv__entry);
+
+	/* The sum of two points isn't determined by their u coordinates alone */
+	if (format == ECC_25519_FORMAT_MONTGOMERY)
+		goto out;
+
+	if (!load_packed(&X_work, X, format) || ecc_25519_is_small_order(&X_work)
+	    || !load_packed(&A_work, A, format) || ecc_25519_is_small_order(&A_work))
+		goto out;
+
+	/* s1 = y + e*b, s2 = s1*d (mod q) */
+	ecc_25519_gf_mult(&s1, e, b);
+	ecc_25519_gf_add(&s1, &s1, y);
+	ecc_25519_gf_reduce(&s1, &s1);
+	ecc_25519_gf_mult(&s2, &s1, d);
+	ecc_25519_gf_reduce(&s2, &s2);
+
+	ecc_25519_scalarmult_joint(&work, &s1, &X_work, &s2, &A_work);
+
+	if (!ecc_25519_is_small_order(&work)) {
+		store_packed(out, &work, format);
+		ret = 1;
+	}
+
+ out:
+	if (!ret) {
+		for (i = 0; i < 32; i++)
+			out->p[i] = 0;
+	}
+
+	PROBE(fhmqv__return);
+	return ret;
 }
@@ -0,0 +1,316 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Parallel batch processing of scalar multiplications
+ *
+ * A set of workers keeps its background threads between batches, so a batch only
+ * needs to wake them up. Each worker (including the calling thread) starts with an
+ * equal share of the jobs and processes them from the front; a worker running out of
+ * jobs steals half of the remaining jobs of another worker from the back, so all
+ * workers finish at roughly the same time even when some of them are slowed down.
+ *
+ * Doxygen comments for public APIs can be found in the public header file.
+ */
+
+#include <libuecc/ecc.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+
+
+/** A worker of a \ref ecc_25519_workers_t */
+typedef struct worker {
+	ecc_25519_workers_t *workers;
+	pthread_t thread;
+
+	/** Protects next and end */
+	pthread_mutex_t mutex;
+	/** The range of jobs that are left for this worker */
+	size_t next, end;
+
+	/** Preallocated state for the scalar multiplications of this worker */
+	ecc_25519_scalarmult_state_t state;
+} worker_t;
+
+struct _ecc_25519_workers {
+	/** The number of workers; worker 0 is run by the thread calling \ref ecc_25519_scalarmult_batch_workers */
+	unsigned n_workers;
+	worker_t *worker;
+
+	/** Protects the following fields */
+	pthread_mutex_t mutex;
+	/** Signalled when a new batch is started or the workers are stopped */
+	pthread_cond_t start;
+	/** Signalled when the last background thread has finished its part of a batch */
+	pthread_cond_t done;
+
+	unsigned generation;
+	unsigned running;
+	int stop;
+
+	/** The current batch */
+	ecc_25519_work_t *out;
+	const ecc_int256_t *n;
+	const ecc_25519_work_t *base;
+};
+
+
+/** Overwrites memory with zeros in a way that isn't optimized out */
+static void clear_memory(void *p, size_t len) {
+	volatile uint8_t *b = p;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		b[i] = 0;
+}
+
+/** Takes a job from the range of a worker, returning 0 if the range is empty */
+static int take_own(worker_t *worker, size_t *job) {
+	int ret = 0;
+
+	pthread_mutex_lock(&worker->mutex);
+
+	if (worker->next < worker->end) {
+		*job = worker->next++;
+		ret = 1;
+	}
+
+	pthread_mutex_unlock(&worker->mutex);
+
+	return ret;
+}
+
+/** Moves half of the remaining jobs of another worker into the range of the given worker */
+static int steal(worker_t *worker) {
+	ecc_25519_workers_t *workers = worker->workers;
+	unsigned index = worker - workers->worker, i;
+	size_t start = 0, end = 0, left;
+
+	for (i = 1; i < workers->n_workers && start == end; i++) {
+		worker_t *victim = &workers->worker[(index + i) % workers->n_workers];
+
+		pthread_mutex_lock(&victim->mutex);
+
+		left = victim->end - victim->next;
+		if (left) {
+			end = victim->end;
+			start = end - (left+1)/2;
+			victim->end = start;
+		}
+
+		pthread_mutex_unlock(&victim->mutex);
+	}
+
+	if (start == end)
+		return 0;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->next = start;
+	worker->end = end;
+	pthread_mutex_unlock(&worker->mutex);
+
+	return 1;
+}
+
+/** Processes jobs of the current batch until none are left */
+static void run_worker(worker_t *worker) {
+	ecc_25519_workers_t *workers = worker->workers;
+	size_t i;
+
+	do {
+		while (take_own(worker, &i)) {
+			if (workers->base) {
+				ecc_25519_scalarmult_begin(&worker->state, &workers->n[i], &workers->base[i]);
+				ecc_25519_scalarmult_finish(&worker->state, &workers->out[i]);
+			}
+			else {
+				ecc_25519_scalarmult_base(&workers->out[i], &workers->n[i]);
+			}
+		}
+	} while (steal(worker));
+}
+
+/** The main loop of the background threads */
+static void * worker_thread(void *arg) {
+	worker_t *worker = arg;
+	ecc_25519_workers_t *workers = worker->workers;
+	unsigned generation = 0;
+
+	pthread_mutex_lock(&workers->mutex);
+
+	while (1) {
+		while (!workers->stop && workers->generation == generation)
+			pthread_cond_wait(&workers->start, &workers->mutex);
+
+		if (workers->stop)
+			break;
+
+		generation = workers->generation;
+		pthread_mutex_unlock(&workers->mutex);
+
+		run_worker(worker);
+
+		pthread_mutex_lock(&workers->mutex);
+		if (--workers->running == 0)
+			pthread_cond_signal(&workers->done);
+	}
+
+	pthread_mutex_unlock(&workers->mutex);
+
+	return NULL;
+}
+
+ecc_25519_workers_t * ecc_25519_workers_new(unsigned threads) {
+	ecc_25519_workers_t *workers;
+	unsigned i;
+
+	if (threads < 1)
+		threads = 1;
+
+	workers = calloc(1, sizeof(*workers));
+	if (!workers)
+		return NULL;
+
+	workers->worker = calloc(threads, sizeof(*workers->worker));
+	if (!workers->worker) {
+		free(workers);
+		return NULL;
+	}
+
+	pthread_mutex_init(&workers->mutex, NULL);
+	pthread_cond_init(&workers->start, NULL);
+	pthread_cond_init(&workers->done, NULL);
+
+	for (i = 0; i < threads; i++) {
+		workers->worker[i].workers = workers;
+		pthread_mutex_init(&workers->worker[i].mutex, NULL);
+	}
+
+	/* If a thread can't be created, the remaining workers will just take over its jobs */
+	for (workers->n_workers = 1; workers->n_workers < threads; workers->n_workers++) {
+		worker_t *worker = &workers->worker[workers->n_workers];
+
+		if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0)
+			break;
+	}
+
+	/* Mutexes of workers without a thread aren't used */
+	for (i = workers->n_workers; i < threads; i++)
+		pthread_mutex_destroy(&workers->worker[i].mutex);
+
+	return workers;
+}
+
+void ecc_25519_workers_free(ecc_25519_workers_t *workers) {
+	unsigned i;
+
+	if (!workers)
+		return;
+
+	pthread_mutex_lock(&workers->mutex);
+	workers->stop = 1;
+	pthread_cond_broadcast(&workers->start);
+	pthread_mutex_unlock(&workers->mutex);
+
+	for (i = 1; i < workers->n_workers; i++)
+		pthread_join(workers->worker[i].thread, NULL);
+
+	for (i = 0; i < workers->n_workers; i++)
+		pthread_mutex_destroy(&workers->worker[i].mutex);
+
+	pthread_cond_destroy(&workers->done);
+	pthread_cond_destroy(&workers->start);
+	pthread_mutex_destroy(&workers->mutex);
+
+	/* The multiplication states contain the last scalars */
+	clear_memory(workers->worker, workers->n_workers * sizeof(*workers->worker));
+
+	free(workers->worker);
+	free(workers);
+}
+
+void ecc_25519_scalarmult_batch_workers(ecc_25519_workers_t *workers, ecc_25519_work_t *out, const ecc_int256_t *n,
+					const ecc_25519_work_t *base, size_t count) {
+	size_t start = 0, share;
+	unsigned i;
+
+	if (!count)
+		return;
+
+	pthread_mutex_lock(&workers->mutex);
+
+	workers->out = out;
+	workers->n = n;
+	workers->base = base;
+
+	/* The background threads are idle, so the ranges can be set without taking the worker mutexes */
+	for (i = 0; i < workers->n_workers; i++) {
+		share = (count - start) / (workers->n_workers - i);
+
+		workers->worker[i].next = start;
+		workers->worker[i].end = start + share;
+		start += share;
+	}
+
+	workers->running = workers->n_workers - 1;
+	workers->generation++;
+	pthread_cond_broadcast(&workers->start);
+
+	pthread_mutex_unlock(&workers->mutex);
+
+	run_worker(&workers->worker[0]);
+
+	pthread_mutex_lock(&workers->mutex);
+	while (workers->running)
+		pthread_cond_wait(&workers->done, &workers->mutex);
+	pthread_mutex_unlock(&workers->mutex);
+}
+
+void ecc_25519_scalarmult_batch(ecc_25519_work_t *out, const ecc_int256_t *n, const ecc_25519_work_t *base, size_t count, unsigned threads) {
+	ecc_25519_workers_t *workers;
+	size_t i;
+
+	if (!count)
+		return;
+
+	if (threads > count)
+		threads = count;
+
+	workers = ecc_25519_workers_new(threads);
+	if (!workers) {
+		for (i = 0; i < count; i++) {
+			if (base)
+				ecc_25519_scalarmult(&out[i], &n[i], &base[i]);
+			else
+				ecc_25519_scalarmult_base(&out[i], &n[i]);
+		}
+
+		return;
+	}
+
+	ecc_25519_scalarmult_batch_workers(workers, out, n, base, count);
+	ecc_25519_workers_free(workers);
+}
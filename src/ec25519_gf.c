@@ -33,6 +33,19 @@
  */
 
 #include <libuecc/ecc.h>
+#include "ec25519_stats.h"
+#include "ec25519_modinv.h"
+
+
+/*
+ * The batch functions use AVX2 kernels processing 8 integers at once when the CPU
+ * supports it; they aren't built when optimizing for size or when UECC_NO_AVX2 is defined
+ * (the checks use this to cover the portable code on CPUs supporting AVX2).
+ */
+#if !defined(UECC_SMALL) && !defined(UECC_NO_AVX2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
 
 
 /** Checks if the highest bit of an uint32_teger is set */
@@ -52,10 +65,18 @@ const ecc_int256_t ecc_25519_gf_order = {{
 /** An internal alias for \ref ecc_25519_gf_order */
 static const uint8_t *q = ecc_25519_gf_order.p;
 
+/** \f$ 2^{512} \bmod q \f$, for the conversion into the Montgomery representation */
+static const uint8_t R2[32] = {
+	0x01, 0x0f, 0x9c, 0x44, 0xe3, 0x11, 0x06, 0xa4,
+	0x47, 0x93, 0x85, 0x68, 0xa7, 0x1b, 0x0e, 0xd0,
+	0x65, 0xbe, 0xf5, 0x17, 0xd2, 0x73, 0xec, 0xce,
+	0x3d, 0x9a, 0x30, 0x7c, 0x1b, 0x41, 0x99, 0x03
+};
+
 /**
  * Copies the content of r into out if b == 0, the contents of s if b == 1
  */
-static void select(uint8_t out[32], const uint8_t r[32], const uint8_t s[32], uint32_t b) {
+static void select_bytes(uint8_t out[32], const uint8_t r[32], const uint8_t s[32], uint32_t b) {
 	unsigned int j;
 	uint8_t t;
 	uint8_t bminus1;
@@ -80,34 +101,44 @@ int ecc_25519_gf_is_zero(const ecc_int256_t *in) {
 	return (((bits-1)>>8) & 1);
 }
 
-void ecc_25519_gf_add(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
+/** Adds two integers modulo q (without full reduction) */
+static void add_bytes(uint8_t out[32], const uint8_t a[32], const uint8_t b[32]) {
 	unsigned int j;
 	uint32_t u;
-	int nq = 1 - (in1->p[31]>>4) - (in2->p[31]>>4);
+	int nq = 1 - (a[31]>>4) - (b[31]>>4);
 
 	u = 0;
 	for (j = 0; j < 32; ++j) {
-		u += in1->p[j] + in2->p[j] + nq*q[j];
+		u += a[j] + b[j] + nq*q[j];
 
-		out->p[j] = u;
+		out[j] = u;
 		u = ASR(u, 8);
 	}
 }
 
-void ecc_25519_gf_sub(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
+/** Subtracts two integers modulo q (without full reduction) */
+static void sub_bytes(uint8_t out[32], const uint8_t a[32], const uint8_t b[32]) {
 	unsigned int j;
 	uint32_t u;
-	int nq = 8 - (in1->p[31]>>4) + (in2->p[31]>>4);
+	int nq = 8 - (a[31]>>4) + (b[31]>>4);
 
 	u = 0;
 	for (j = 0; j < 32; ++j) {
-		u += in1->p[j] - in2->p[j] + nq*q[j];
+		u += a[j] - b[j] + nq*q[j];
 
-		out->p[j] = u;
+		out[j] = u;
 		u = ASR(u, 8);
 	}
 }
 
+void ecc_25519_gf_add(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
+	add_bytes(out->p, in1->p, in2->p);
+}
+
+void ecc_25519_gf_sub(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
+	sub_bytes(out->p, in1->p, in2->p);
+}
+
 /** Reduces an integer to a unique representation in the range \f$ [0,q-1] \f$ */
 static void reduce(uint8_t a[32]) {
 	unsigned int j;
@@ -115,6 +146,8 @@ static void reduce(uint8_t a[32]) {
 	uint32_t u1, u2;
 	uint8_t out1[32], out2[32];
 
+	STATS_INC(gf_reduce);
+
 	u1 = u2 = 0;
 	for (j = 0; j < 31; ++j) {
 		u1 += a[j] - nq*q[j];
@@ -128,7 +161,7 @@ static void reduce(uint8_t a[32]) {
 	u2 += a[31] - (nq-1)*q[31];
 	out1[31] = u1; out2[31] = u2;
 
-	select(a, out1, out2, IS_NEGATIVE(u1));
+	select_bytes(a, out1, out2, IS_NEGATIVE(u1));
 }
 
 void ecc_25519_gf_reduce(ecc_int256_t *out, const ecc_int256_t *in) {
@@ -146,6 +179,8 @@ static void montgomery(uint8_t out[32], const uint8_t a[32], const uint8_t b[32]
 	uint32_t nq;
 	uint32_t u;
 
+	STATS_INC(gf_montgomery);
+
 	for (i = 0; i < 32; i++)
 		out[i] = 0;
 
@@ -165,14 +200,6 @@ static void montgomery(uint8_t out[32], const uint8_t a[32], const uint8_t b[32]
 }
 
 void ecc_25519_gf_mult(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
-	/* 2^512 mod q */
-	static const uint8_t C[32] = {
-		0x01, 0x0f, 0x9c, 0x44, 0xe3, 0x11, 0x06, 0xa4,
-		0x47, 0x93, 0x85, 0x68, 0xa7, 0x1b, 0x0e, 0xd0,
-		0x65, 0xbe, 0xf5, 0x17, 0xd2, 0x73, 0xec, 0xce,
-		0x3d, 0x9a, 0x30, 0x7c, 0x1b, 0x41, 0x99, 0x03
-	};
-
 	uint8_t B[32];
 	uint8_t R[32];
 	unsigned int i;
@@ -183,9 +210,11 @@ void ecc_25519_gf_mult(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int
 	reduce(B);
 
 	montgomery(R, in1->p, B);
-	montgomery(out->p, R, C);
+	montgomery(out->p, R, R2);
 }
 
+#ifdef UECC_FERMAT_INVERSION
+
 void ecc_25519_gf_recip(ecc_int256_t *out, const ecc_int256_t *in) {
 	static const uint8_t C[32] = {
 		0x01
@@ -239,6 +268,34 @@ void ecc_25519_gf_recip(ecc_int256_t *out, const ecc_int256_t *in) {
 	montgomery(out->p, R2, C);
 }
 
+#else
+
+/** The group order for \ref modinv */
+static const modinv_modinfo_t modinfo_q = {
+	{{
+		0x1cf5d3ed, 0x20498c69, 0x2f79cd65, 0x37be77a8, 0x14,
+		0x0, 0x0, 0x0, 0x1000
+	}},
+	0x2dab81e5 /* q^-1 mod 2^30 */
+};
+
+void ecc_25519_gf_recip(ecc_int256_t *out, const ecc_int256_t *in) {
+	modinv_signed30_t x;
+	uint8_t A[32];
+	unsigned int i;
+
+	for (i = 0; i < 32; i++)
+		A[i] = in->p[i];
+
+	reduce(A);
+
+	modinv_from_bytes(&x, A);
+	modinv(&x, &modinfo_q);
+	modinv_to_bytes(out->p, &x);
+}
+
+#endif
+
 void ecc_25519_gf_sanitize_secret(ecc_int256_t *out, const ecc_int256_t *in) {
 	int i;
 
@@ -249,3 +306,290 @@ void ecc_25519_gf_sanitize_secret(ecc_int256_t *out, const ecc_int256_t *in) {
 	out->p[31] &= 0x7f;
 	out->p[31] |= 0x40;
 }
+
+/*
+ * The Montgomery representation of a is a * 2^256 mod q. All functions keep the
+ * representation fully reduced, which is cheap compared to the multiplications.
+ */
+
+void ecc_25519_gf_mont_to(ecc_25519_gf_mont_t *out, const ecc_int256_t *in) {
+	uint8_t A[32];
+	unsigned int i;
+
+	for (i = 0; i < 32; i++)
+		A[i] = in->p[i];
+
+	reduce(A);
+
+	montgomery(out->m, A, R2);
+	reduce(out->m);
+}
+
+void ecc_25519_gf_mont_from(ecc_int256_t *out, const ecc_25519_gf_mont_t *in) {
+	static const uint8_t C[32] = {
+		0x01
+	};
+
+	montgomery(out->p, in->m, C);
+	reduce(out->p);
+}
+
+void ecc_25519_gf_mont_add(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in1, const ecc_25519_gf_mont_t *in2) {
+	add_bytes(out->m, in1->m, in2->m);
+	reduce(out->m);
+}
+
+void ecc_25519_gf_mont_sub(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in1, const ecc_25519_gf_mont_t *in2) {
+	sub_bytes(out->m, in1->m, in2->m);
+	reduce(out->m);
+}
+
+void ecc_25519_gf_mont_mult(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in1, const ecc_25519_gf_mont_t *in2) {
+	uint8_t R[32];
+	unsigned int i;
+
+	montgomery(R, in1->m, in2->m);
+	reduce(R);
+
+	for (i = 0; i < 32; i++)
+		out->m[i] = R[i];
+}
+
+void ecc_25519_gf_mont_square(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in) {
+	ecc_25519_gf_mont_mult(out, in, in);
+}
+
+void ecc_25519_gf_mont_pow(ecc_25519_gf_mont_t *out, const ecc_25519_gf_mont_t *in, const ecc_int256_t *exp) {
+	static const uint8_t C[32] = {
+		0x01
+	};
+
+	uint8_t A[32], R[32], T[32];
+	unsigned int i;
+	int pos;
+
+	for (i = 0; i < 32; i++)
+		A[i] = in->m[i];
+
+	/* The Montgomery representation of 1 is 2^256 mod q */
+	montgomery(R, C, R2);
+	reduce(R);
+
+	for (pos = 255; pos >= 0; --pos) {
+		montgomery(T, R, R);
+		reduce(T);
+
+		montgomery(R, T, A);
+		reduce(R);
+
+		select_bytes(R, T, R, (exp->p[pos / 8] >> (pos & 7)) & 1);
+	}
+
+	for (i = 0; i < 32; i++)
+		out->m[i] = R[i];
+}
+
+
+#ifdef HAVE_AVX2_KERNELS
+
+/*
+ * The AVX2 kernels keep 8 integers in a structure-of-arrays layout: each of the 32 vectors holds
+ * the same byte of all 8 integers in 32-bit lanes. They do exactly the same 32-bit operations as the
+ * scalar functions in each lane (ASR becomes an arithmetic shift), so the results are bit-identical.
+ */
+
+/** Number of integers processed by the AVX2 kernels at once */
+#define LANES 8
+
+#define AVX2 __attribute__((target("avx2")))
+
+/** Loads 8 integers into the lanes of v */
+AVX2 static void load_lanes(__m256i v[32], const ecc_int256_t *in) {
+	uint32_t t[32][LANES] __attribute__((aligned(32)));
+	unsigned int i, l;
+
+	for (l = 0; l < LANES; l++) {
+		for (i = 0; i < 32; i++)
+			t[i][l] = in[l].p[i];
+	}
+
+	for (i = 0; i < 32; i++)
+		v[i] = _mm256_load_si256((const __m256i *)t[i]);
+}
+
+/** Stores the lanes of v as 8 integers, keeping the lowest byte of each lane */
+AVX2 static void store_lanes(ecc_int256_t *out, const __m256i v[32]) {
+	uint32_t t[32][LANES] __attribute__((aligned(32)));
+	unsigned int i, l;
+
+	for (i = 0; i < 32; i++)
+		_mm256_store_si256((__m256i *)t[i], v[i]);
+
+	for (l = 0; l < LANES; l++) {
+		for (i = 0; i < 32; i++)
+			out[l].p[i] = t[i][l];
+	}
+}
+
+/** 8-lane version of \ref add_bytes */
+AVX2 static void add_avx2(__m256i out[32], const __m256i a[32], const __m256i b[32]) {
+	const __m256i mask = _mm256_set1_epi32(255);
+	__m256i nq, u = _mm256_setzero_si256();
+	unsigned int j;
+
+	nq = _mm256_sub_epi32(_mm256_set1_epi32(1), _mm256_srli_epi32(a[31], 4));
+	nq = _mm256_sub_epi32(nq, _mm256_srli_epi32(b[31], 4));
+
+	for (j = 0; j < 32; ++j) {
+		u = _mm256_add_epi32(u, _mm256_add_epi32(_mm256_add_epi32(a[j], b[j]), _mm256_mullo_epi32(nq, _mm256_set1_epi32(q[j]))));
+
+		out[j] = _mm256_and_si256(u, mask);
+		u = _mm256_srai_epi32(u, 8);
+	}
+}
+
+/** 8-lane version of \ref reduce */
+AVX2 static void reduce_avx2(__m256i a[32]) {
+	const __m256i mask = _mm256_set1_epi32(255);
+	__m256i nq = _mm256_srli_epi32(a[31], 4), nq1 = _mm256_sub_epi32(nq, _mm256_set1_epi32(1));
+	__m256i u1 = _mm256_setzero_si256(), u2 = _mm256_setzero_si256();
+	__m256i out1[32], out2[32], neg;
+	unsigned int j;
+
+	for (j = 0; j < 32; ++j) {
+		u1 = _mm256_add_epi32(u1, _mm256_sub_epi32(a[j], _mm256_mullo_epi32(nq, _mm256_set1_epi32(q[j]))));
+		u2 = _mm256_add_epi32(u2, _mm256_sub_epi32(a[j], _mm256_mullo_epi32(nq1, _mm256_set1_epi32(q[j]))));
+
+		out1[j] = _mm256_and_si256(u1, mask);
+		out2[j] = _mm256_and_si256(u2, mask);
+
+		if (j < 31) {
+			u1 = _mm256_srai_epi32(u1, 8);
+			u2 = _mm256_srai_epi32(u2, 8);
+		}
+	}
+
+	neg = _mm256_srai_epi32(u1, 31);
+	for (j = 0; j < 32; ++j)
+		a[j] = _mm256_blendv_epi8(out1[j], out2[j], neg);
+}
+
+/** 8-lane version of \ref montgomery */
+AVX2 static void montgomery_avx2(__m256i out[32], const __m256i a[32], const __m256i b[32]) {
+	const __m256i mask = _mm256_set1_epi32(255);
+	__m256i u, nq, t;
+	unsigned int i, j;
+
+	for (i = 0; i < 32; i++)
+		out[i] = _mm256_setzero_si256();
+
+	for (i = 0; i < 32; i++) {
+		u = _mm256_add_epi32(out[0], _mm256_mullo_epi32(a[i], b[0]));
+		nq = _mm256_and_si256(_mm256_mullo_epi32(u, _mm256_set1_epi32(27)), mask);
+		u = _mm256_add_epi32(u, _mm256_mullo_epi32(nq, _mm256_set1_epi32(q[0])));
+
+		for (j = 1; j < 32; ++j) {
+			t = _mm256_add_epi32(out[j], _mm256_mullo_epi32(a[i], b[j]));
+			t = _mm256_add_epi32(t, _mm256_mullo_epi32(nq, _mm256_set1_epi32(q[j])));
+			u = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_slli_epi32(t, 8)), 8);
+			out[j-1] = _mm256_and_si256(u, mask);
+		}
+
+		out[31] = _mm256_and_si256(_mm256_srli_epi32(u, 8), mask);
+	}
+}
+
+AVX2 static void add_batch_avx2(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
+	__m256i A[32], B[32];
+
+	load_lanes(A, in1);
+	load_lanes(B, in2);
+	add_avx2(A, A, B);
+	store_lanes(out, A);
+}
+
+AVX2 static void reduce_batch_avx2(ecc_int256_t *out, const ecc_int256_t *in) {
+	__m256i A[32];
+	unsigned int l;
+
+	for (l = 0; l < LANES; l++)
+		STATS_INC(gf_reduce);
+
+	load_lanes(A, in);
+	reduce_avx2(A);
+	store_lanes(out, A);
+}
+
+AVX2 static void mult_batch_avx2(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2) {
+	__m256i A[32], B[32], R[32], C[32];
+	unsigned int i, l;
+
+	for (l = 0; l < LANES; l++) {
+		STATS_INC(gf_reduce);
+		STATS_INC(gf_montgomery);
+		STATS_INC(gf_montgomery);
+	}
+
+	load_lanes(A, in1);
+	load_lanes(B, in2);
+
+	for (i = 0; i < 32; i++)
+		C[i] = _mm256_set1_epi32(R2[i]);
+
+	reduce_avx2(B);
+	montgomery_avx2(R, A, B);
+	montgomery_avx2(A, R, C);
+
+	store_lanes(out, A);
+}
+
+/** Checks if the AVX2 kernels can be used */
+static int have_avx2(void) {
+	return __builtin_cpu_supports("avx2");
+}
+
+#undef AVX2
+
+#endif
+
+void ecc_25519_gf_add_batch(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2, size_t count) {
+	size_t i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+	if (have_avx2()) {
+		for (; i + LANES <= count; i += LANES)
+			add_batch_avx2(out+i, in1+i, in2+i);
+	}
+#endif
+
+	for (; i < count; i++)
+		ecc_25519_gf_add(&out[i], &in1[i], &in2[i]);
+}
+
+void ecc_25519_gf_reduce_batch(ecc_int256_t *out, const ecc_int256_t *in, size_t count) {
+	size_t i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+	if (have_avx2()) {
+		for (; i + LANES <= count; i += LANES)
+			reduce_batch_avx2(out+i, in+i);
+	}
+#endif
+
+	for (; i < count; i++)
+		ecc_25519_gf_reduce(&out[i], &in[i]);
+}
+
+void ecc_25519_gf_mult_batch(ecc_int256_t *out, const ecc_int256_t *in1, const ecc_int256_t *in2, size_t count) {
+	size_t i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+	if (have_avx2()) {
+		for (; i + LANES <= count; i += LANES)
+			mult_batch_avx2(out+i, in1+i, in2+i);
+	}
+#endif
+
+	for (; i < count; i++)
+		ecc_25519_gf_mult(&out[i], &in1[i], &in2[i]);
+}
@@ -0,0 +1,288 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  Partly based on the safegcd implementation of libsecp256k1 (MIT license).
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Internal constant-time modular inversion
+ *
+ * This implements the safegcd algorithm by Bernstein and Yang ("Fast constant-time gcd
+ * computation and modular inversion") with integers in signed 30-bit limbs, as done by
+ * libsecp256k1. It is used to compute reciprocals modulo \f$ p = 2^{255} - 19 \f$ and
+ * modulo the group order, which is much faster than the exponentiation used by Fermat's
+ * little theorem. When libuecc is built with UECC_FERMAT_INVERSION defined (the CMake option
+ * ENABLE_FERMAT_INVERSION), the exponentiation is used instead and this header is empty.
+ */
+
+#ifndef _LIBUECC_EC25519_MODINV_H_
+#define _LIBUECC_EC25519_MODINV_H_
+
+#ifndef UECC_FERMAT_INVERSION
+
+#include <stdint.h>
+
+
+/** Mask of the bits of a limb */
+#define M30 ((int32_t)(UINT32_MAX >> 2))
+
+
+/** A signed integer of up to 9 limbs of 30 bits each (the top limb carries the sign) */
+typedef struct modinv_signed30 {
+	int32_t v[9];
+} modinv_signed30_t;
+
+/** An odd modulus with its inverse modulo \f$ 2^{30} \f$ */
+typedef struct modinv_modinfo {
+	modinv_signed30_t modulus;
+	uint32_t modulus_inv30;
+} modinv_modinfo_t;
+
+/** The transition matrix of 30 divsteps, scaled by \f$ 2^{30} \f$ */
+typedef struct modinv_trans2x2 {
+	int32_t u, v, q, r;
+} modinv_trans2x2_t;
+
+
+/** Converts an unsigned little-endian integer of 256 bits into signed 30-bit limbs */
+static void modinv_from_bytes(modinv_signed30_t *out, const uint8_t in[32]) {
+	uint64_t acc = 0;
+	int bits = 0, i, j = 0;
+
+	for (i = 0; i < 32; i++) {
+		acc |= (uint64_t)in[i] << bits;
+		bits += 8;
+
+		if (bits >= 30) {
+			out->v[j++] = acc & M30;
+			acc >>= 30;
+			bits -= 30;
+		}
+	}
+
+	out->v[8] = acc;
+}
+
+/** Converts a non-negative integer of less than 256 bits in signed 30-bit limbs into an unsigned little-endian integer */
+static void modinv_to_bytes(uint8_t out[32], const modinv_signed30_t *in) {
+	uint64_t acc = 0;
+	int bits = 0, i, j = 0;
+
+	for (i = 0; i < 32; i++) {
+		if (bits < 8) {
+			acc |= (uint64_t)in->v[j++] << bits;
+			bits += 30;
+		}
+
+		out[i] = acc;
+		acc >>= 8;
+		bits -= 8;
+	}
+}
+
+/**
+ * Does 30 divsteps in constant time, starting with the given zeta (the negated delta minus 1/2)
+ *
+ * Only the bottom 30 bits of f and g are used. Returns the new zeta and sets t to the transition matrix.
+ */
+static int32_t modinv_divsteps_30(int32_t zeta, uint32_t f0, uint32_t g0, modinv_trans2x2_t *t) {
+	uint32_t u = 1, v = 0, q = 0, r = 1;
+	uint32_t c1, c2, f = f0, g = g0, x, y, z;
+	int i;
+
+	for (i = 0; i < 30; i++) {
+		/* c1 is -1 if zeta < 0 (delta > 0), c2 is -1 if g is odd */
+		c1 = -((uint32_t)zeta >> 31);
+		c2 = -(g & 1);
+
+		/* Conditionally negate f, u and v, and add them to g, q and r if g is odd */
+		x = (f ^ c1) - c1;
+		y = (u ^ c1) - c1;
+		z = (v ^ c1) - c1;
+		g += x & c2;
+		q += y & c2;
+		r += z & c2;
+
+		/* When delta > 0 and g is odd, swap (f, u, v) with the new (g, q, r) and negate zeta */
+		c1 &= c2;
+		zeta = (zeta ^ (int32_t)c1) - 1;
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+
+	t->u = (int32_t)u;
+	t->v = (int32_t)v;
+	t->q = (int32_t)q;
+	t->r = (int32_t)r;
+
+	return zeta;
+}
+
+/**
+ * Computes (t/2^30) * [d, e] modulo the modulus
+ *
+ * d and e must be in the range \f$ (-2m, m) \f$; the results are in the same range.
+ */
+static void modinv_update_de_30(modinv_signed30_t *d, modinv_signed30_t *e, const modinv_trans2x2_t *t, const modinv_modinfo_t *mi) {
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t di, ei, md, me, sd, se;
+	int64_t cd, ce;
+	int i;
+
+	/* Add the modulus to the results for each negative input, so they become non-negative before the division */
+	sd = d->v[8] >> 31;
+	se = e->v[8] >> 31;
+	md = (u & sd) + (v & se);
+	me = (q & sd) + (r & se);
+
+	di = d->v[0];
+	ei = e->v[0];
+	cd = (int64_t)u * di + (int64_t)v * ei;
+	ce = (int64_t)q * di + (int64_t)r * ei;
+
+	/* Choose the multiples of the modulus to add so the bottom 30 bits become zero */
+	md -= (mi->modulus_inv30 * (uint32_t)cd + md) & M30;
+	me -= (mi->modulus_inv30 * (uint32_t)ce + me) & M30;
+
+	cd += (int64_t)mi->modulus.v[0] * md;
+	ce += (int64_t)mi->modulus.v[0] * me;
+	cd >>= 30;
+	ce >>= 30;
+
+	for (i = 1; i < 9; i++) {
+		di = d->v[i];
+		ei = e->v[i];
+		cd += (int64_t)u * di + (int64_t)v * ei;
+		ce += (int64_t)q * di + (int64_t)r * ei;
+		cd += (int64_t)mi->modulus.v[i] * md;
+		ce += (int64_t)mi->modulus.v[i] * me;
+
+		d->v[i-1] = (int32_t)cd & M30;
+		e->v[i-1] = (int32_t)ce & M30;
+		cd >>= 30;
+		ce >>= 30;
+	}
+
+	d->v[8] = (int32_t)cd;
+	e->v[8] = (int32_t)ce;
+}
+
+/** Computes (t/2^30) * [f, g], which is exact */
+static void modinv_update_fg_30(modinv_signed30_t *f, modinv_signed30_t *g, const modinv_trans2x2_t *t) {
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t fi, gi;
+	int64_t cf, cg;
+	int i;
+
+	fi = f->v[0];
+	gi = g->v[0];
+	cf = (int64_t)u * fi + (int64_t)v * gi;
+	cg = (int64_t)q * fi + (int64_t)r * gi;
+	cf >>= 30;
+	cg >>= 30;
+
+	for (i = 1; i < 9; i++) {
+		fi = f->v[i];
+		gi = g->v[i];
+		cf += (int64_t)u * fi + (int64_t)v * gi;
+		cg += (int64_t)q * fi + (int64_t)r * gi;
+
+		f->v[i-1] = (int32_t)cf & M30;
+		g->v[i-1] = (int32_t)cg & M30;
+		cf >>= 30;
+		cg >>= 30;
+	}
+
+	f->v[8] = (int32_t)cf;
+	g->v[8] = (int32_t)cg;
+}
+
+/**
+ * Brings r from the range \f$ (-2m, m) \f$ into \f$ [0, m) \f$, negating it first if sign is negative
+ *
+ * The top limb of the result is normalized as well.
+ */
+static void modinv_normalize_30(modinv_signed30_t *r, int32_t sign, const modinv_modinfo_t *mi) {
+	int32_t cond_add, cond_negate;
+	int i;
+
+	/* Add the modulus if r is negative */
+	cond_add = r->v[8] >> 31;
+	for (i = 0; i < 9; i++)
+		r->v[i] += mi->modulus.v[i] & cond_add;
+
+	/* Negate r if f is negative, which gives a value in (-m, m) */
+	cond_negate = sign >> 31;
+	for (i = 0; i < 9; i++)
+		r->v[i] = (r->v[i] ^ cond_negate) - cond_negate;
+
+	for (i = 0; i < 8; i++) {
+		r->v[i+1] += r->v[i] >> 30;
+		r->v[i] &= M30;
+	}
+
+	/* Add the modulus again if r is still negative */
+	cond_add = r->v[8] >> 31;
+	for (i = 0; i < 9; i++)
+		r->v[i] += mi->modulus.v[i] & cond_add;
+
+	for (i = 0; i < 8; i++) {
+		r->v[i+1] += r->v[i] >> 30;
+		r->v[i] &= M30;
+	}
+}
+
+/**
+ * Replaces x by its inverse modulo the modulus of mi in constant time
+ *
+ * x must be in the range \f$ [0, m) \f$; the result is in the same range (0 is mapped to 0).
+ * The modulus must be odd and less than \f$ 2^{256} \f$, which needs at most 590 divsteps.
+ */
+static void modinv(modinv_signed30_t *x, const modinv_modinfo_t *mi) {
+	modinv_signed30_t d = {{0}}, e = {{1}};
+	modinv_signed30_t f = mi->modulus, g = *x;
+	modinv_trans2x2_t t;
+	int32_t zeta = -1;
+	int i;
+
+	for (i = 0; i < 20; i++) {
+		zeta = modinv_divsteps_30(zeta, f.v[0], g.v[0], &t);
+		modinv_update_de_30(&d, &e, &t, mi);
+		modinv_update_fg_30(&f, &g, &t);
+	}
+
+	/* g is zero now and f is +/-1 (or +/-m for x == 0, where d is zero as well) */
+	modinv_normalize_30(&d, f.v[8], mi);
+	*x = d;
+}
+
+#undef M30
+
+#endif /* UECC_FERMAT_INVERSION */
+
+#endif /* _LIBUECC_EC25519_MODINV_H_ */
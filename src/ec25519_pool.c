@@ -0,0 +1,271 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Pool of precomputed ephemeral keypairs
+ *
+ * The keypairs are generated by a single background thread and handed out through a
+ * single-producer single-consumer ring, so taking a keypair never blocks. The producer
+ * sleeps while the pool is more than half full; it is woken by the consumer when the
+ * pool drains to half its size, which is the only time the consumer takes the mutex.
+ *
+ * Doxygen comments for public APIs can be found in the public header file.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <libuecc/ecc.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+
+/** The maximum number of keypairs whose packed representations are computed together */
+#define POOL_BATCH 16
+
+
+struct _ecc_25519_pool {
+	/** The number of keypairs the pool holds when it is full */
+	size_t size;
+	/** The producer is woken when the number of keypairs drops to this value */
+	size_t refill;
+
+	ecc_25519_format_t format;
+	int (*random)(void *arg, uint8_t *buf, size_t len);
+	void *random_arg;
+
+	/** The ring of keypairs; in is only written by the producer, out only by the consumer */
+	ecc_25519_keypair_t *ring;
+	size_t ring_mask;
+	size_t in;
+	size_t out;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int stop;
+
+	pthread_t thread;
+
+	/** Scratch space of the producer */
+	ecc_25519_work_t points[POOL_BATCH];
+	ecc_int256_t packed[POOL_BATCH];
+};
+
+
+/** Overwrites a keypair in a way that can't be optimized out */
+static void wipe_keypair(ecc_25519_keypair_t *keypair) {
+	volatile uint8_t *b = (volatile uint8_t *)keypair;
+	size_t i;
+
+	for (i = 0; i < sizeof(*keypair); i++)
+		b[i] = 0;
+}
+
+/** Returns the number of keypairs in the pool as seen by the producer */
+static size_t pool_fill(ecc_25519_pool_t *pool) {
+	return pool->in - __atomic_load_n(&pool->out, __ATOMIC_SEQ_CST);
+}
+
+/** Generates up to POOL_BATCH keypairs into the free part of the ring and publishes them */
+static int pool_generate(ecc_25519_pool_t *pool, size_t n) {
+	ecc_25519_keypair_t *keypair;
+	size_t i;
+
+	if (n > POOL_BATCH)
+		n = POOL_BATCH;
+
+	for (i = 0; i < n; i++) {
+		keypair = &pool->ring[(pool->in + i) & pool->ring_mask];
+
+		if (!pool->random(pool->random_arg, keypair->secret.p, sizeof(keypair->secret.p))) {
+			for (n = i+1, i = 0; i < n; i++)
+				wipe_keypair(&pool->ring[(pool->in + i) & pool->ring_mask]);
+
+			return 0;
+		}
+
+		ecc_25519_gf_sanitize_secret(&keypair->secret, &keypair->secret);
+		ecc_25519_scalarmult_base(&pool->points[i], &keypair->secret);
+	}
+
+	switch (pool->format) {
+	case ECC_25519_FORMAT_ED25519:
+		ecc_25519_store_packed_ed25519_batch(pool->packed, pool->points, n);
+		break;
+
+	case ECC_25519_FORMAT_LEGACY:
+		ecc_25519_store_packed_legacy_batch(pool->packed, pool->points, n);
+		break;
+
+	case ECC_25519_FORMAT_RISTRETTO255:
+		/* The Ristretto255 encoding needs an inverse square root per point, so there is no reciprocal to share */
+		for (i = 0; i < n; i++)
+			ecc_25519_store_packed_ristretto255(&pool->packed[i], &pool->points[i]);
+		break;
+
+	default:
+		ecc_25519_store_packed_montgomery_batch(pool->packed, pool->points, n);
+	}
+
+	for (i = 0; i < n; i++) {
+		keypair = &pool->ring[(pool->in + i) & pool->ring_mask];
+		keypair->work = pool->points[i];
+		keypair->packed = pool->packed[i];
+	}
+
+	__atomic_store_n(&pool->in, pool->in + n, __ATOMIC_SEQ_CST);
+
+	return 1;
+}
+
+static void * pool_worker(void *arg) {
+	ecc_25519_pool_t *pool = arg;
+	int ok = 1;
+
+#ifdef SCHED_IDLE
+	/* Key generation should only use otherwise idle CPU time; failure is not critical */
+	struct sched_param param = { 0 };
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (ok) {
+		while (!pool->stop && pool_fill(pool) > pool->refill)
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+
+		if (pool->stop)
+			break;
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		while (ok && !__atomic_load_n(&pool->stop, __ATOMIC_RELAXED) && pool_fill(pool) < pool->size)
+			ok = pool_generate(pool, pool->size - pool_fill(pool));
+
+		pthread_mutex_lock(&pool->mutex);
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+ecc_25519_pool_t * ecc_25519_pool_new(size_t size, ecc_25519_format_t format, int (*random)(void *arg, uint8_t *buf, size_t len), void *random_arg) {
+	ecc_25519_pool_t *pool;
+	size_t ring_size;
+
+	if (!size || !random)
+		return NULL;
+
+	for (ring_size = 1; ring_size < size; ring_size <<= 1) {}
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pool->size = size;
+	pool->refill = size/2;
+	pool->format = format;
+	pool->random = random;
+	pool->random_arg = random_arg;
+
+	pool->ring = calloc(ring_size, sizeof(*pool->ring));
+	pool->ring_mask = ring_size - 1;
+
+	if (!pool->ring)
+		goto err_free;
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+
+	if (pthread_create(&pool->thread, NULL, pool_worker, pool) != 0) {
+		pthread_cond_destroy(&pool->cond);
+		pthread_mutex_destroy(&pool->mutex);
+		goto err_free;
+	}
+
+	return pool;
+
+ err_free:
+	free(pool->ring);
+	free(pool);
+	return NULL;
+}
+
+void ecc_25519_pool_free(ecc_25519_pool_t *pool) {
+	size_t i;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	__atomic_store_n(&pool->stop, 1, __ATOMIC_RELAXED);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	pthread_join(pool->thread, NULL);
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->mutex);
+
+	for (i = 0; i <= pool->ring_mask; i++)
+		wipe_keypair(&pool->ring[i]);
+
+	free(pool->ring);
+	free(pool);
+}
+
+int ecc_25519_pool_get(ecc_25519_pool_t *pool, ecc_25519_keypair_t *keypair) {
+	size_t out = pool->out;
+	size_t in = __atomic_load_n(&pool->in, __ATOMIC_ACQUIRE);
+	ecc_25519_keypair_t *slot;
+
+	if (in == out)
+		return 0;
+
+	slot = &pool->ring[out & pool->ring_mask];
+	*keypair = *slot;
+	wipe_keypair(slot);
+
+	__atomic_store_n(&pool->out, out+1, __ATOMIC_SEQ_CST);
+
+	/*
+	 * While the producer is waiting, only the consumer changes the number of keypairs,
+	 * so it always passes the refill mark exactly. The sequential consistency of the
+	 * accesses to in and out ensures that either the producer sees the new value of out
+	 * before deciding to wait, or the consumer sees all keypairs published before that.
+	 */
+	in = __atomic_load_n(&pool->in, __ATOMIC_SEQ_CST);
+	if (in - (out+1) == pool->refill) {
+		pthread_mutex_lock(&pool->mutex);
+		pthread_cond_signal(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return 1;
+}
@@ -0,0 +1,346 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Asynchronous queue for Diffie-Hellman jobs
+ *
+ * Submitted jobs are kept in a simple mutex-protected ring, from which they are
+ * taken by the worker threads. Finished jobs are pushed into a lock-free completion
+ * ring (a bounded queue with per-cell sequence numbers as described by Dmitry Vyukov),
+ * so the workers never block the thread collecting the results, and an eventfd (or a
+ * pipe on systems without eventfd) is signalled.
+ *
+ * As the number of jobs in the queue is limited by its size, the completion ring can
+ * never overflow.
+ *
+ * Doxygen comments for public APIs can be found in the public header file.
+ */
+
+#include <libuecc/ecc.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+
+/** An entry of the completion ring */
+typedef struct completion {
+	size_t seq;
+	ecc_25519_job_t job;
+} completion_t;
+
+struct _ecc_25519_queue {
+	/** The number of jobs that may be in the queue at the same time */
+	size_t size;
+
+	/** The number of jobs that have been submitted, but not yet collected */
+	size_t pending;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int stop;
+
+	/** Submitted jobs; protected by the mutex */
+	ecc_25519_job_t *jobs;
+	size_t jobs_head;
+	size_t jobs_count;
+
+	/** Finished jobs */
+	completion_t *completions;
+	size_t completions_mask;
+	size_t completions_in;
+	size_t completions_out;
+
+	/** File descriptors for signalling finished jobs; the same on systems with eventfd */
+	int fd_read;
+	int fd_write;
+
+	unsigned n_threads;
+	pthread_t *threads;
+};
+
+
+/** Overwrites memory that may contain secrets in a way that can't be optimized out */
+static void wipe(void *p, size_t len) {
+	volatile uint8_t *b = p;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		b[i] = 0;
+}
+
+/** Signals the file descriptor */
+static void signal_fd(ecc_25519_queue_t *queue) {
+	uint64_t v = 1;
+
+	while (write(queue->fd_write, &v, sizeof(v)) < 0 && errno == EINTR) {}
+}
+
+/** Resets the file descriptor */
+static void clear_fd(ecc_25519_queue_t *queue) {
+	uint64_t v[16];
+	ssize_t r;
+
+	do {
+		r = read(queue->fd_read, v, sizeof(v));
+	} while (r > 0 || (r < 0 && errno == EINTR));
+}
+
+/** Pushes a finished job into the completion ring; may be called from multiple threads at the same time */
+static void push_completion(ecc_25519_queue_t *queue, const ecc_25519_job_t *job) {
+	size_t pos = __atomic_load_n(&queue->completions_in, __ATOMIC_RELAXED);
+	completion_t *c;
+
+	while (1) {
+		c = &queue->completions[pos & queue->completions_mask];
+
+		/* As there are never more jobs in the queue than the ring can hold, the cell can only be in use by another thread that has already taken it */
+		if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) == pos
+		    && __atomic_compare_exchange_n(&queue->completions_in, &pos, pos+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+
+		pos = __atomic_load_n(&queue->completions_in, __ATOMIC_RELAXED);
+	}
+
+	c->job = *job;
+	__atomic_store_n(&c->seq, pos+1, __ATOMIC_RELEASE);
+}
+
+/** Takes a finished job from the completion ring; must only be called from a single thread at a time */
+static int pop_completion(ecc_25519_queue_t *queue, ecc_25519_job_t *job) {
+	size_t pos = queue->completions_out;
+	completion_t *c = &queue->completions[pos & queue->completions_mask];
+
+	if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) != pos+1)
+		return 0;
+
+	*job = c->job;
+	wipe(&c->job, sizeof(c->job));
+
+	__atomic_store_n(&c->seq, pos + queue->completions_mask + 1, __ATOMIC_RELEASE);
+	queue->completions_out = pos+1;
+
+	return 1;
+}
+
+/** Checks if there are finished jobs left in the completion ring */
+static int has_completion(const ecc_25519_queue_t *queue) {
+	size_t pos = queue->completions_out;
+	const completion_t *c = &queue->completions[pos & queue->completions_mask];
+
+	return (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) == pos+1);
+}
+
+static void * queue_worker(void *arg) {
+	ecc_25519_queue_t *queue = arg;
+	ecc_25519_job_t job, *slot;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while (1) {
+		while (!queue->stop && !queue->jobs_count)
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+
+		if (queue->stop)
+			break;
+
+		slot = &queue->jobs[queue->jobs_head];
+		queue->jobs_head = (queue->jobs_head + 1) % queue->size;
+		queue->jobs_count--;
+
+		job = *slot;
+		wipe(slot, sizeof(*slot));
+
+		pthread_mutex_unlock(&queue->mutex);
+
+		job.status = ecc_25519_ecdh_packed(&job.result, &job.secret, &job.peer, job.format);
+		wipe(&job.secret, sizeof(job.secret));
+
+		push_completion(queue, &job);
+		wipe(&job, sizeof(job));
+		signal_fd(queue);
+
+		pthread_mutex_lock(&queue->mutex);
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+
+	return NULL;
+}
+
+/** Opens the file descriptors used to signal finished jobs */
+static int open_fd(ecc_25519_queue_t *queue) {
+#ifdef __linux__
+	queue->fd_read = queue->fd_write = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	return (queue->fd_read >= 0);
+#else
+	int fds[2], i;
+
+	if (pipe(fds) < 0)
+		return 0;
+
+	for (i = 0; i < 2; i++) {
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	queue->fd_read = fds[0];
+	queue->fd_write = fds[1];
+	return 1;
+#endif
+}
+
+static void close_fd(ecc_25519_queue_t *queue) {
+	close(queue->fd_read);
+	if (queue->fd_write != queue->fd_read)
+		close(queue->fd_write);
+}
+
+ecc_25519_queue_t * ecc_25519_queue_new(unsigned threads, size_t size) {
+	ecc_25519_queue_t *queue;
+	size_t ring_size, i;
+
+	if (!threads || !size)
+		return NULL;
+
+	for (ring_size = 1; ring_size < size; ring_size <<= 1) {}
+
+	queue = calloc(1, sizeof(*queue));
+	if (!queue)
+		return NULL;
+
+	queue->size = size;
+	queue->jobs = calloc(size, sizeof(*queue->jobs));
+	queue->completions = calloc(ring_size, sizeof(*queue->completions));
+	queue->completions_mask = ring_size - 1;
+	queue->threads = calloc(threads, sizeof(*queue->threads));
+
+	if (!queue->jobs || !queue->completions || !queue->threads)
+		goto err_free;
+
+	for (i = 0; i < ring_size; i++)
+		queue->completions[i].seq = i;
+
+	if (!open_fd(queue))
+		goto err_free;
+
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->cond, NULL);
+
+	for (queue->n_threads = 0; queue->n_threads < threads; queue->n_threads++) {
+		if (pthread_create(&queue->threads[queue->n_threads], NULL, queue_worker, queue) != 0)
+			break;
+	}
+
+	if (!queue->n_threads) {
+		ecc_25519_queue_free(queue);
+		return NULL;
+	}
+
+	return queue;
+
+ err_free:
+	free(queue->threads);
+	free(queue->completions);
+	free(queue->jobs);
+	free(queue);
+	return NULL;
+}
+
+void ecc_25519_queue_free(ecc_25519_queue_t *queue) {
+	unsigned i;
+
+	if (!queue)
+		return;
+
+	pthread_mutex_lock(&queue->mutex);
+	queue->stop = 1;
+	pthread_cond_broadcast(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+
+	for (i = 0; i < queue->n_threads; i++)
+		pthread_join(queue->threads[i], NULL);
+
+	pthread_cond_destroy(&queue->cond);
+	pthread_mutex_destroy(&queue->mutex);
+
+	close_fd(queue);
+
+	wipe(queue->jobs, queue->size * sizeof(*queue->jobs));
+	wipe(queue->completions, (queue->completions_mask + 1) * sizeof(*queue->completions));
+
+	free(queue->threads);
+	free(queue->completions);
+	free(queue->jobs);
+	free(queue);
+}
+
+int ecc_25519_queue_fd(const ecc_25519_queue_t *queue) {
+	return queue->fd_read;
+}
+
+int ecc_25519_queue_submit(ecc_25519_queue_t *queue, const ecc_25519_job_t *job) {
+	if (queue->pending >= queue->size)
+		return 0;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	queue->jobs[(queue->jobs_head + queue->jobs_count) % queue->size] = *job;
+	queue->jobs_count++;
+
+	pthread_cond_signal(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+
+	queue->pending++;
+
+	return 1;
+}
+
+size_t ecc_25519_queue_poll(ecc_25519_queue_t *queue, ecc_25519_job_t *jobs, size_t max) {
+	size_t n = 0;
+
+	/*
+	 * The file descriptor must be reset before the completion ring is checked, as the
+	 * workers signal it only after pushing their jobs into the ring.
+	 */
+	clear_fd(queue);
+
+	while (n < max && pop_completion(queue, &jobs[n]))
+		n++;
+
+	/* Keep the file descriptor readable when not all finished jobs could be returned */
+	if (has_completion(queue))
+		signal_fd(queue);
+
+	queue->pending -= n;
+
+	return n;
+}
@@ -0,0 +1,60 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Access to the operation counters
+ *
+ * Doxygen comments for public APIs can be found in the public header file.
+ */
+
+#include "ec25519_stats.h"
+
+
+#ifdef UECC_STATS
+
+__thread ecc_25519_stats_t ecc_25519_stats_thread;
+
+void ecc_25519_stats_get(ecc_25519_stats_t *out) {
+	*out = ecc_25519_stats_thread;
+}
+
+void ecc_25519_stats_reset(void) {
+	static const ecc_25519_stats_t zero = {0};
+
+	ecc_25519_stats_thread = zero;
+}
+
+#else
+
+void ecc_25519_stats_get(ecc_25519_stats_t *out) {
+	static const ecc_25519_stats_t zero = {0};
+
+	*out = zero;
+}
+
+void ecc_25519_stats_reset(void) {
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Internal instrumentation macros
+ *
+ * When libuecc is built with UECC_STATS defined (the CMake option ENABLE_STATS),
+ * STATS_INC counts the calls of the internal field operations in per-thread counters;
+ * when built with UECC_USDT (the CMake option ENABLE_USDT), PROBE places USDT
+ * static probes with the provider name libuecc. Otherwise, the macros don't generate any code.
+ */
+
+#ifndef _LIBUECC_EC25519_STATS_H_
+#define _LIBUECC_EC25519_STATS_H_
+
+#include <libuecc/ecc.h>
+
+
+#ifdef UECC_STATS
+
+/** The counters of the current thread */
+extern __thread ecc_25519_stats_t ecc_25519_stats_thread;
+
+#define STATS_INC(counter) (ecc_25519_stats_thread.counter++)
+
+#else
+
+#define STATS_INC(counter) do {} while (0)
+
+#endif
+
+
+#ifdef UECC_USDT
+
+#include <sys/sdt.h>
+
+#define PROBE(name) DTRACE_PROBE(libuecc, name)
+
+#else
+
+#define PROBE(name) do {} while (0)
+
+#endif
+
+
+#endif /* _LIBUECC_EC25519_STATS_H_ */
@@ -0,0 +1,617 @@
+/*
+  Copyright (c) 2012-2015, Matthias Schiffer <mschiffer@universe-factory.net>
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    1. Redistributions of source code must retain the above copyright notice,
+       this list of conditions and the following disclaimer.
+    2. Redistributions in binary form must reproduce the above copyright notice,
+       this list of conditions and the following disclaimer in the documentation
+       and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/** \file
+ * Checks of libuecc against known answers and against its own scalar functions
+ *
+ * Usage: check_uecc [filter]
+ *
+ * Only checks whose names contain the filter string are run. The exit status is 0 if all
+ * checks passed.
+ *
+ * This file is built twice: check_uecc uses the AVX2 kernels of the batch functions when the
+ * CPU supports them, check_uecc_portable is built with UECC_NO_AVX2 and covers the portable code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Included so the batch functions are built with the flags of this check */
+#include "ec25519_gf.c"
+
+
+typedef struct check {
+	const char *name;
+	unsigned (*run)(void);
+} check_t;
+
+
+/** The number of integers processed at once by the batch kernels */
+#define BATCH_LANES 8
+
+/** The largest count given to the batch functions */
+#define BATCH_MAX (2*BATCH_LANES + 7)
+
+
+/** State of the generator for the inputs */
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+/** Fills an integer with deterministic pseudo-random bytes (xorshift64*) */
+static void random_int(ecc_int256_t *out) {
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		rng_state ^= rng_state >> 12;
+		rng_state ^= rng_state << 25;
+		rng_state ^= rng_state >> 27;
+		out->p[i] = (rng_state * 0x2545f4914f6cdd1dull) >> 56;
+	}
+}
+
+/** Fills an array of integers; the first entries are the edge cases 0, q-1, q and 2^256-1 */
+static void random_ints(ecc_int256_t *out, size_t count) {
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		switch (i) {
+		case 0:
+			memset(out[i].p, 0, 32);
+			break;
+
+		case 1:
+		case 2:
+			out[i] = ecc_25519_gf_order;
+			if (i == 1)
+				out[i].p[0]--;
+			break;
+
+		case 3:
+			memset(out[i].p, 0xff, 32);
+			break;
+
+		default:
+			random_int(&out[i]);
+		}
+	}
+}
+
+/** Parses len bytes given as a string of hex digits */
+static void from_hex(uint8_t *out, const char *hex, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		unsigned v;
+
+		sscanf(hex + 2*i, "%2x", &v);
+		out[i] = v;
+	}
+}
+
+static unsigned report(const char *name, size_t count, size_t index) {
+	fprintf(stderr, "FAIL: %s, count %u, index %u\n", name, (unsigned)count, (unsigned)index);
+	return 1;
+}
+
+static unsigned report_vector(const char *name, size_t index) {
+	fprintf(stderr, "FAIL: %s, vector %u\n", name, (unsigned)index);
+	return 1;
+}
+
+/** Compares count results with the expected values; the entry after them must be left untouched */
+static unsigned compare(const char *name, const ecc_int256_t *out, const ecc_int256_t *expected, const ecc_int256_t *guard, size_t count) {
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (memcmp(out[i].p, expected[i].p, 32))
+			return report(name, count, i);
+	}
+
+	if (memcmp(out[count].p, guard->p, 32))
+		return report(name, count, count);
+
+	return 0;
+}
+
+
+/** Compares the batch functions with the scalar functions for all counts up to two full batches and a partial one */
+static unsigned check_gf_batch(void) {
+	ecc_int256_t a[BATCH_MAX+1], b[BATCH_MAX+1], expected[BATCH_MAX+1], out[BATCH_MAX+1];
+	unsigned failed = 0;
+	size_t count, i;
+
+	for (count = 0; count <= BATCH_MAX; count++) {
+		random_ints(a, count+1);
+		random_ints(b, count+1);
+
+		/* b is rotated, so the edge cases are combined with each other */
+		for (i = 0; i < count/2 && i < 4; i++) {
+			ecc_int256_t t = b[i];
+			b[i] = b[count-1-i];
+			b[count-1-i] = t;
+		}
+
+		for (i = 0; i < count; i++)
+			ecc_25519_gf_add(&expected[i], &a[i], &b[i]);
+		out[count] = a[count];
+		ecc_25519_gf_add_batch(out, a, b, count);
+		failed += compare("gf_add_batch", out, expected, &a[count], count);
+		memcpy(out, a, sizeof(out));
+		ecc_25519_gf_add_batch(out, out, b, count);
+		failed += compare("gf_add_batch (out = in1)", out, expected, &a[count], count);
+		memcpy(out, b, sizeof(out));
+		ecc_25519_gf_add_batch(out, a, out, count);
+		failed += compare("gf_add_batch (out = in2)", out, expected, &b[count], count);
+
+		for (i = 0; i < count; i++)
+			ecc_25519_gf_add(&expected[i], &a[i], &a[i]);
+		memcpy(out, a, sizeof(out));
+		ecc_25519_gf_add_batch(out, out, out, count);
+		failed += compare("gf_add_batch (out = in1 = in2)", out, expected, &a[count], count);
+
+		for (i = 0; i < count; i++)
+			ecc_25519_gf_reduce(&expected[i], &a[i]);
+		out[count] = b[count];
+		ecc_25519_gf_reduce_batch(out, a, count);
+		failed += compare("gf_reduce_batch", out, expected, &b[count], count);
+		memcpy(out, a, sizeof(out));
+		ecc_25519_gf_reduce_batch(out, out, count);
+		failed += compare("gf_reduce_batch (out = in)", out, expected, &a[count], count);
+
+		for (i = 0; i < count; i++)
+			ecc_25519_gf_mult(&expected[i], &a[i], &b[i]);
+		out[count] = a[count];
+		ecc_25519_gf_mult_batch(out, a, b, count);
+		failed += compare("gf_mult_batch", out, expected, &a[count], count);
+		memcpy(out, a, sizeof(out));
+		ecc_25519_gf_mult_batch(out, out, b, count);
+		failed += compare("gf_mult_batch (out = in1)", out, expected, &a[count], count);
+		memcpy(out, b, sizeof(out));
+		ecc_25519_gf_mult_batch(out, a, out, count);
+		failed += compare("gf_mult_batch (out = in2)", out, expected, &b[count], count);
+
+		for (i = 0; i < count; i++)
+			ecc_25519_gf_mult(&expected[i], &a[i], &a[i]);
+		memcpy(out, a, sizeof(out));
+		ecc_25519_gf_mult_batch(out, out, out, count);
+		failed += compare("gf_mult_batch (out = in1 = in2)", out, expected, &a[count], count);
+	}
+
+	return failed;
+}
+
+
+/** RFC 9496, appendix A.1: the encodings of the multiples 0 to 15 of the base point */
+static const char *const ristretto255_multiples[] = {
+	"0000000000000000000000000000000000000000000000000000000000000000",
+	"e2f2ae0a6abc4e71a884a961c500515f58e30b6aa582dd8db6a65945e08d2d76",
+	"6a493210f7499cd17fecb510ae0cea23a110e8d5b901f8acadd3095c73a3b919",
+	"94741f5d5d52755ece4f23f044ee27d5d1ea1e2bd196b462166b16152a9d0259",
+	"da80862773358b466ffadfe0b3293ab3d9fd53c5ea6c955358f568322daf6a57",
+	"e882b131016b52c1d3337080187cf768423efccbb517bb495ab812c4160ff44e",
+	"f64746d3c92b13050ed8d80236a7f0007c3b3f962f5ba793d19a601ebb1df403",
+	"44f53520926ec81fbd5a387845beb7df85a96a24ece18738bdcfa6a7822a176d",
+	"903293d8f2287ebe10e2374dc1a53e0bc887e592699f02d077d5263cdd55601c",
+	"02622ace8f7303a31cafc63f8fc48fdc16e1c8c8d234b2f0d6685282a9076031",
+	"20706fd788b2720a1ed2a5dad4952b01f413bcf0e7564de8cdc816689e2db95f",
+	"bce83f8ba5dd2fa572864c24ba1810f9522bc6004afe95877ac73241cafdab42",
+	"e4549ee16b9aa03099ca208c67adafcafa4c3f3e4e5303de6026e3ca8ff84460",
+	"aa52e000df2e16f55fb1032fc33bc42742dad6bd5a8fc0be0167436c5948501f",
+	"46376b80f409b29dc2b5f6f0c52591990896e5716f41477cd30085ab7f10301e",
+	"e0c418f7c8d9c4cdd7395b93ea124f3ad99021bb681dfc3302a9d99a2e53e64e",
+};
+
+/** RFC 9496, appendix A.2: invalid encodings */
+static const char *const ristretto255_invalid[] = {
+	/* Non-canonical field encodings */
+	"00ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+	"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+	"f3ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+	"edffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+
+	/* Negative field elements */
+	"0100000000000000000000000000000000000000000000000000000000000000",
+	"01ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+	"ed57ffd8c914fb201471d1c3d245ce3c746fcbe63a3679d51b6a516ebebe0e20",
+	"c34c4e1826e5d403b78e246e88aa051c36ccf0aafebffe137d148a2bf9104562",
+	"c940e5a4404157cfb1628b108db051a8d439e1a421394ec4ebccb9ec92a8ac78",
+	"47cfc5497c53dc8e61c91d17fd626ffb1c49e2bca94eed052281b510b1117a24",
+	"f1c6165d33367351b0da8f6e4511010c68174a03b6581212c71c0e1d026c3c72",
+	"87260f7a2f12495118360f02c26a470f450dadf34a413d21042b43b9d93e1309",
+
+	/* Non-square x^2 */
+	"26948d35ca62e643e26a83177332e6b6afeb9d08e4268b650f1f5bbd8d81d371",
+	"4eac077a713c57b4f4397629a4145982c661f48044dd3f96427d40b147d9742f",
+	"de6a7b00deadc788eb6b6c8d20c0ae96c2f2019078fa604fee5b87d6e989ad7b",
+	"bcab477be20861e01e4a0e295284146a510150d9817763caf1a6f4b422d67042",
+	"2a292df7e32cababbd9de088d1d1abec9fc0440f637ed2fba145094dc14bea08",
+	"f4a9e534fc0d216c44b218fa0c42d99635a0127ee2e53c712f70609649fdff22",
+	"8268436f8c4126196cf64b3c7ddbda90746a378625f9813dd9b8457077256731",
+	"2810e5cbc2cc4d4eece54f61c6f69758e289aa7ab440b3cbeaa21995c2f4232b",
+
+	/* Negative xy value */
+	"3eb858e78f5a7254d8c9731174a94f76755fd3941c0ac93735c07ba14579630e",
+	"a45fdc55c76448c049a1ab33f17023edfb2be3581e9c7aade8a6125215e04220",
+	"d483fe813c6ba647ebbfd3ec41adca1c6130c2beeee9d9bf065c8d151c5f396e",
+	"8a2e1d30050198c65a54483123960ccc38aef6848e1ec8f5f780e8523769ba32",
+	"32888462f8b486c68ad7dd9610be5192bbeaf3b443951ac1a8118419d9fa097b",
+	"227142501b9d4355ccba290404bde41575b037693cef1f438c47f8fbf35d1165",
+	"5c37cc491da847cfeb9281d407efc41e15144c876e0170b499a96a22ed31e01e",
+	"445425117cb8c90edcbc7c1cc0e74f747f2c1efa5630a967c64f287792a48a4b",
+
+	/* s = -1, which causes y = 0 */
+	"ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+};
+
+/** RFC 9496, appendix A.3: inputs and results of the one-way map */
+static const char *const ristretto255_from_uniform[][2] = {
+	{
+		"5d1be09e3d0c82fc538112490e35701979d99e06ca3e2b5b54bffe8b4dc772c14d98b696a1bbfb5ca32c436cc61c16563790306c79eaca7705668b47dffe5bb6",
+		"3066f82a1a747d45120d1740f14358531a8f04bbffe6a819f86dfe50f44a0a46",
+	},
+	{
+		"f116b34b8f17ceb56e8732a60d913dd10cce47a6d53bee9204be8b44f6678b270102a56902e2488c46120e9276cfe54638286b9e4b3cdb470b542d46c2068d38",
+		"f26e5b6f7d362d2d2a94c5d0e7602cb4773c95a2e5c31a64f133189fa76ed61b",
+	},
+	{
+		"8422e1bbdaab52938b81fd602effb6f89110e1e57208ad12d9ad767e2e25510c27140775f9337088b982d83d7fcf0b2fa1edffe51952cbe7365e95c86eaf325c",
+		"006ccd2a9e6867e6a2c5cea83d3302cc9de128dd2a9a57dd8ee7b9d7ffe02826",
+	},
+	{
+		"ac22415129b61427bf464e17baee8db65940c233b98afce8d17c57beeb7876c2150d15af1cb1fb824bbd14955f2b57d08d388aab431a391cfc33d5bafb5dbbaf",
+		"f8f0c87cf237953c5890aec3998169005dae3eca1fbb04548c635953c817f92a",
+	},
+	{
+		"165d697a1ef3d5cf3c38565beefcf88c0f282b8e7dbd28544c483432f1cec7675debea8ebb4e5fe7d6f6e5db15f15587ac4d4d4a1de7191e0c1ca6664abcc413",
+		"ae81e7dedf20a497e10c304a765c1767a42d6e06029758d2d7e8ef7cc4c41179",
+	},
+	{
+		"a836e6c9a9ca9f1e8d486273ad56a78c70cf18f0ce10abb1c7172ddd605d7fd2979854f47ae1ccf204a33102095b4200e5befc0465accc263175485f0e17ea5c",
+		"e2705652ff9f5e44d3e841bf1c251cf7dddb77d140870d1ab2ed64f1a9ce8628",
+	},
+	{
+		"2cdc11eaeb95daf01189417cdddbf95952993aa9cb9c640eb5058d09702c74622c9965a697a3b345ec24ee56335b556e677b30e6f90ac77d781064f866a3c982",
+		"80bd07262511cdde4863f8a7434cef696750681cb9510eea557088f76d9e5065",
+	},
+};
+
+/** Checks the Ristretto255 functions with the test vectors of RFC 9496 */
+static unsigned check_ristretto255(void) {
+	const size_t n_multiples = sizeof(ristretto255_multiples) / sizeof(ristretto255_multiples[0]);
+	const size_t n_invalid = sizeof(ristretto255_invalid) / sizeof(ristretto255_invalid[0]);
+	const size_t n_from_uniform = sizeof(ristretto255_from_uniform) / sizeof(ristretto255_from_uniform[0]);
+	ecc_25519_work_t sum = ecc_25519_work_identity, P, Q;
+	ecc_int256_t expected, out, n;
+	uint8_t uniform[64];
+	unsigned failed = 0;
+	size_t i;
+
+	for (i = 0; i < n_multiples; i++) {
+		from_hex(expected.p, ristretto255_multiples[i], 32);
+
+		memset(n.p, 0, 32);
+		n.p[0] = i;
+		ecc_25519_scalarmult_base(&P, &n);
+		ecc_25519_store_packed_ristretto255(&out, &P);
+		if (memcmp(out.p, expected.p, 32))
+			failed += report_vector("store_packed_ristretto255 (scalarmult_base)", i);
+
+		/* The sums have a different representation than the results of the scalar multiplication */
+		ecc_25519_store_packed_ristretto255(&out, &sum);
+		if (memcmp(out.p, expected.p, 32) || !ecc_25519_ristretto255_equal(&sum, &P))
+			failed += report_vector("store_packed_ristretto255 (add)", i);
+		ecc_25519_add(&sum, &sum, &ecc_25519_work_default_base);
+
+		if (!ecc_25519_load_packed_ristretto255(&Q, &expected) || !ecc_25519_ristretto255_equal(&Q, &P)) {
+			failed += report_vector("load_packed_ristretto255", i);
+			continue;
+		}
+
+		ecc_25519_store_packed_ristretto255(&out, &Q);
+		if (memcmp(out.p, expected.p, 32))
+			failed += report_vector("load_packed_ristretto255 (store)", i);
+	}
+
+	for (i = 0; i < n_invalid; i++) {
+		from_hex(n.p, ristretto255_invalid[i], 32);
+
+		if (ecc_25519_load_packed_ristretto255(&P, &n))
+			failed += report_vector("load_packed_ristretto255 (invalid)", i);
+	}
+
+	for (i = 0; i < n_from_uniform; i++) {
+		from_hex(uniform, ristretto255_from_uniform[i][0], 64);
+		from_hex(expected.p, ristretto255_from_uniform[i][1], 32);
+
+		ecc_25519_ristretto255_from_uniform(&P, uniform);
+		ecc_25519_store_packed_ristretto255(&out, &P);
+		if (memcmp(out.p, expected.p, 32))
+			failed += report_vector("ristretto255_from_uniform", i);
+	}
+
+	return failed;
+}
+
+
+/** RFC 7748, section 5.2: scalar, input u coordinate, output u coordinate and whether the input is on the curve (or on its twist) */
+static const struct {
+	const char *scalar;
+	const char *u;
+	const char *result;
+	int on_curve;
+} x25519_vectors[] = {
+	{
+		"a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+		"e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+		"c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552",
+		1,
+	},
+	{
+		"4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+		"e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+		"95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957",
+		0,
+	},
+};
+
+/**
+ * Checks the Montgomery format with the X25519 test vectors of RFC 7748
+ *
+ * The scalars are clamped like in X25519. The second input lies on the twist, so ecc_25519_ecdh_packed
+ * must accept it, while ecc_25519_load_packed_montgomery must reject it.
+ */
+static unsigned check_montgomery(void) {
+	const size_t n_vectors = sizeof(x25519_vectors) / sizeof(x25519_vectors[0]);
+	ecc_int256_t secret, u, expected, out;
+	ecc_25519_work_t P;
+	unsigned failed = 0;
+	size_t i;
+
+	for (i = 0; i < n_vectors; i++) {
+		from_hex(secret.p, x25519_vectors[i].scalar, 32);
+		from_hex(u.p, x25519_vectors[i].u, 32);
+		from_hex(expected.p, x25519_vectors[i].result, 32);
+		ecc_25519_gf_sanitize_secret(&secret, &secret);
+
+		if (!ecc_25519_ecdh_packed(&out, &secret, &u, ECC_25519_FORMAT_MONTGOMERY) || memcmp(out.p, expected.p, 32))
+			failed += report_vector("ecdh_packed (Montgomery format)", i);
+
+		if (ecc_25519_load_packed_montgomery(&P, &u) != x25519_vectors[i].on_curve) {
+			failed += report_vector("load_packed_montgomery", i);
+			continue;
+		}
+
+		if (!x25519_vectors[i].on_curve)
+			continue;
+
+		ecc_25519_scalarmult(&P, &secret, &P);
+		ecc_25519_store_packed_montgomery(&out, &P);
+		if (memcmp(out.p, expected.p, 32))
+			failed += report_vector("load_packed_montgomery (scalarmult)", i);
+	}
+
+	return failed;
+}
+
+
+/** Compares the batch stores with storing single points, for all counts up to BATCH_MAX */
+static unsigned check_store_batch(void) {
+	static const struct {
+		const char *name;
+		void (*store)(ecc_int256_t *, const ecc_25519_work_t *);
+		void (*store_batch)(ecc_int256_t *, const ecc_25519_work_t *, size_t);
+	} formats[] = {
+		{ "store_packed_ed25519_batch", ecc_25519_store_packed_ed25519, ecc_25519_store_packed_ed25519_batch },
+		{ "store_packed_legacy_batch", ecc_25519_store_packed_legacy, ecc_25519_store_packed_legacy_batch },
+		{ "store_packed_montgomery_batch", ecc_25519_store_packed_montgomery, ecc_25519_store_packed_montgomery_batch },
+	};
+	const size_t n_formats = sizeof(formats) / sizeof(formats[0]);
+	ecc_25519_work_t points[BATCH_MAX];
+	ecc_int256_t expected[BATCH_MAX+1], out[BATCH_MAX+1], n;
+	unsigned failed = 0;
+	size_t count, f, i;
+
+	/* The identity (stored as u = 0 in the Montgomery format) and points with Z != 1 are included */
+	for (i = 0; i < BATCH_MAX; i++) {
+		random_int(&n);
+		if (i == 5)
+			memset(n.p, 0, 32);
+
+		ecc_25519_scalarmult_base(&points[i], &n);
+	}
+
+	for (f = 0; f < n_formats; f++) {
+		for (i = 0; i < BATCH_MAX; i++)
+			formats[f].store(&expected[i], &points[i]);
+
+		for (count = 0; count <= BATCH_MAX; count++) {
+			memset(out[count].p, 0xaa, 32);
+			memset(expected[count].p, 0xaa, 32);
+
+			formats[f].store_batch(out, points, count);
+			failed += compare(formats[f].name, out, expected, &expected[count], count);
+
+			if (count < BATCH_MAX)
+				formats[f].store(&expected[count], &points[count]);
+		}
+	}
+
+	return failed;
+}
+
+
+/** The number of points transcoded at once; more than two chunks sharing a reciprocal */
+#define TRANSCODE_POINTS 40
+
+/** Indices of the invalid inputs of the transcoding checks, in different chunks */
+static const size_t transcode_invalid[] = { 3, 17, 39 };
+
+/** Finds the smallest packed value above start rejected by a load function */
+static void find_invalid(ecc_int256_t *out, int (*load)(ecc_25519_work_t *, const ecc_int256_t *), uint8_t start) {
+	ecc_25519_work_t P;
+
+	memset(out->p, 0, 32);
+	out->p[0] = start;
+
+	while (load(&P, out))
+		out->p[0]++;
+}
+
+/**
+ * Transcodes TRANSCODE_POINTS points and compares the results with the expected ones
+ *
+ * The entries at the indices in \ref transcode_invalid must be reported as invalid and zeroed if
+ * invalid is set, all other entries must match.
+ */
+static unsigned check_transcode_direction(const char *name, const ecc_int256_t *in, const ecc_int256_t *expected,
+					  ecc_25519_format_t from, ecc_25519_format_t to, int invalid) {
+	const size_t n_invalid = sizeof(transcode_invalid) / sizeof(transcode_invalid[0]);
+	ecc_int256_t out[TRANSCODE_POINTS], zero_int = {{ 0 }};
+	int status[TRANSCODE_POINTS];
+	unsigned failed = 0;
+	size_t i, j, ret;
+
+	ret = ecc_25519_transcode_packed_batch(out, status, in, TRANSCODE_POINTS, from, to);
+	if (ret != (invalid ? TRANSCODE_POINTS - n_invalid : TRANSCODE_POINTS))
+		failed += report_vector(name, TRANSCODE_POINTS);
+
+	for (i = 0; i < TRANSCODE_POINTS; i++) {
+		int ok = 1;
+
+		for (j = 0; j < n_invalid; j++) {
+			if (invalid && transcode_invalid[j] == i)
+				ok = 0;
+		}
+
+		if (status[i] != ok || memcmp(out[i].p, ok ? expected[i].p : zero_int.p, 32))
+			failed += report_vector(name, i);
+	}
+
+	return failed;
+}
+
+/** Checks the transcoding between the Ed25519, the legacy and the Montgomery format against loading and storing single points */
+static unsigned check_transcode(void) {
+	const size_t n_invalid = sizeof(transcode_invalid) / sizeof(transcode_invalid[0]);
+	ecc_int256_t ed25519[TRANSCODE_POINTS], legacy[TRANSCODE_POINTS], montgomery[TRANSCODE_POINTS];
+	ecc_int256_t ed25519_bad[TRANSCODE_POINTS], legacy_bad[TRANSCODE_POINTS], montgomery_bad[TRANSCODE_POINTS], montgomery_twist[TRANSCODE_POINTS];
+	ecc_int256_t ed25519_even[TRANSCODE_POINTS], legacy_even[TRANSCODE_POINTS], tmp[TRANSCODE_POINTS], tmp2[TRANSCODE_POINTS], n;
+	ecc_25519_work_t P;
+	unsigned failed = 0;
+	size_t i;
+
+	for (i = 0; i < TRANSCODE_POINTS; i++) {
+		random_int(&n);
+		ecc_25519_scalarmult_base(&P, &n);
+
+		ecc_25519_store_packed_ed25519(&ed25519[i], &P);
+		ecc_25519_store_packed_legacy(&legacy[i], &P);
+		ecc_25519_store_packed_montgomery(&montgomery[i], &P);
+
+		/* The Montgomery format loses the sign of x, so the way back gives the point with even x */
+		ecc_25519_load_packed_montgomery(&P, &montgomery[i]);
+		ecc_25519_store_packed_ed25519(&ed25519_even[i], &P);
+		ecc_25519_store_packed_legacy(&legacy_even[i], &P);
+	}
+
+	memcpy(ed25519_bad, ed25519, sizeof(ed25519));
+	memcpy(legacy_bad, legacy, sizeof(legacy));
+	memcpy(montgomery_bad, montgomery, sizeof(montgomery));
+	memcpy(montgomery_twist, montgomery, sizeof(montgomery));
+
+	for (i = 0; i < n_invalid; i++) {
+		size_t k = transcode_invalid[i];
+
+		find_invalid(&ed25519_bad[k], ecc_25519_load_packed_ed25519, 2*i);
+		find_invalid(&legacy_bad[k], ecc_25519_load_packed_legacy, 2*i);
+		find_invalid(&montgomery_twist[k], ecc_25519_load_packed_montgomery, 2*i);
+
+		/* u = -1 is the only input the conversion from the Montgomery to the Ed25519 format rejects */
+		memset(montgomery_bad[k].p, 0xff, 32);
+		montgomery_bad[k].p[0] = 0xec;
+		montgomery_bad[k].p[31] = 0x7f;
+	}
+
+	failed += check_transcode_direction("transcode Ed25519 -> legacy", ed25519_bad, legacy, ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_LEGACY, 1);
+	failed += check_transcode_direction("transcode legacy -> Ed25519", legacy_bad, ed25519, ECC_25519_FORMAT_LEGACY, ECC_25519_FORMAT_ED25519, 1);
+	failed += check_transcode_direction("transcode Ed25519 -> Montgomery", ed25519, montgomery, ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_MONTGOMERY, 0);
+	failed += check_transcode_direction("transcode legacy -> Montgomery", legacy_bad, montgomery, ECC_25519_FORMAT_LEGACY, ECC_25519_FORMAT_MONTGOMERY, 1);
+	failed += check_transcode_direction("transcode Montgomery -> Ed25519", montgomery_bad, ed25519_even, ECC_25519_FORMAT_MONTGOMERY, ECC_25519_FORMAT_ED25519, 1);
+	failed += check_transcode_direction("transcode Montgomery -> legacy", montgomery_twist, legacy_even, ECC_25519_FORMAT_MONTGOMERY, ECC_25519_FORMAT_LEGACY, 1);
+
+	/* Round trips: Ed25519 -> legacy -> Ed25519 keeps the point, the way through the Montgomery format keeps it up to the sign of x */
+	ecc_25519_transcode_packed_batch(tmp, NULL, ed25519, TRANSCODE_POINTS, ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_LEGACY);
+	failed += check_transcode_direction("round trip Ed25519 -> legacy -> Ed25519", tmp, ed25519, ECC_25519_FORMAT_LEGACY, ECC_25519_FORMAT_ED25519, 0);
+
+	ecc_25519_transcode_packed_batch(tmp2, NULL, tmp, TRANSCODE_POINTS, ECC_25519_FORMAT_LEGACY, ECC_25519_FORMAT_MONTGOMERY);
+	ecc_25519_transcode_packed_batch(tmp, NULL, tmp2, TRANSCODE_POINTS, ECC_25519_FORMAT_MONTGOMERY, ECC_25519_FORMAT_ED25519);
+	failed += check_transcode_direction("round trip Ed25519 -> legacy -> Montgomery -> Ed25519 -> legacy", tmp, legacy_even,
+					    ECC_25519_FORMAT_ED25519, ECC_25519_FORMAT_LEGACY, 0);
+
+	return failed;
+}
+
+
+static const check_t checks[] = {
+	{ "gf_batch", check_gf_batch },
+	{ "ristretto255", check_ristretto255 },
+	{ "montgomery", check_montgomery },
+	{ "transcode", check_transcode },
+	{ "store_batch", check_store_batch },
+};
+
+
+int main(int argc, char *argv[]) {
+	const unsigned n_checks = sizeof(checks) / sizeof(checks[0]);
+	const char *filter = NULL;
+	unsigned failed = 0, i;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [filter]\n", argv[0]);
+		return 2;
+	}
+
+	if (argc > 1)
+		filter = argv[1];
+
+#ifdef HAVE_AVX2_KERNELS
+	printf("batch functions: %s\n", have_avx2() ? "AVX2 kernels" : "portable (CPU doesn't support AVX2)");
+#else
+	printf("batch functions: portable\n");
+#endif
+
+	for (i = 0; i < n_checks; i++) {
+		unsigned n;
+
+		if (filter && !strstr(checks[i].name, filter))
+			continue;
+
+		n = checks[i].run();
+		printf("%-20s %s\n", checks[i].name, n ? "FAILED" : "ok");
+		failed += n;
+	}
+
+	return failed ? 1 : 0;
+}